@@ -0,0 +1,75 @@
+# Confronta un bench.json con quello di riferimento (cmake -P, dal target
+# bench_check o a mano con un bench.json copiato dalla Vita):
+#   RESULT           bench.json appena scritto
+#   BASELINE         riferimento, obbligatorio
+#   TOLERANCE        peggioramento ammesso in percento (predefinito 5)
+#   UPDATE_BASELINE  ON: RESULT diventa il riferimento, senza confronto
+cmake_minimum_required(VERSION 3.21)
+
+if(NOT DEFINED TOLERANCE)
+    set(TOLERANCE 5)
+endif()
+
+if(NOT EXISTS "${RESULT}")
+    message(FATAL_ERROR "bench_check: ${RESULT} non trovato")
+endif()
+file(READ "${RESULT}" result_json)
+
+if(NOT BASELINE)
+    message(FATAL_ERROR "bench_check: manca il riferimento, impostare VITA_BENCH_BASELINE (BASELINE)")
+endif()
+
+if(UPDATE_BASELINE)
+    file(WRITE "${BASELINE}" "${result_json}")
+    message(STATUS "bench_check: riferimento aggiornato in ${BASELINE}")
+    return()
+endif()
+
+if(NOT EXISTS "${BASELINE}")
+    message(FATAL_ERROR "bench_check: ${BASELINE} non trovato; per crearlo "
+                        "-DVITA_BENCH_UPDATE_BASELINE=ON (UPDATE_BASELINE=ON)")
+endif()
+file(READ "${BASELINE}" baseline_json)
+
+string(JSON base_engine ERROR_VARIABLE err GET "${baseline_json}" engine)
+string(JSON new_engine ERROR_VARIABLE err GET "${result_json}" engine)
+message(STATUS "bench_check: riferimento su doomgeneric ${base_engine}, build su ${new_engine}")
+
+# Misure con impostazioni diverse non si confrontano
+foreach(key resolution nopresent nodraw)
+    string(JSON base_value GET "${baseline_json}" ${key})
+    string(JSON new_value GET "${result_json}" ${key})
+    if(NOT base_value STREQUAL new_value)
+        message(FATAL_ERROR "bench_check: ${key} e' ${new_value}, nel riferimento ${base_value}")
+    endif()
+endforeach()
+
+# string(JSON) restituisce i tempi in ms come double (0.98999...): in us,
+# arrotondati, diventano interi per math()
+function(ms_to_us ms out)
+    string(REGEX MATCH "^([0-9]+)(\\.([0-9]*))?" unused "${ms}")
+    set(frac "${CMAKE_MATCH_3}0000")
+    string(SUBSTRING "${frac}" 0 4 frac)
+    math(EXPR us "${CMAKE_MATCH_1} * 1000 + (${frac} + 5) / 10")
+    set(${out} ${us} PARENT_SCOPE)
+endfunction()
+
+set(failed FALSE)
+foreach(stat avg p99)
+    string(JSON base_ms GET "${baseline_json}" total frame_ms ${stat})
+    string(JSON new_ms GET "${result_json}" total frame_ms ${stat})
+    ms_to_us(${base_ms} base_us)
+    ms_to_us(${new_ms} new_us)
+
+    math(EXPR limit_us "${base_us} * (100 + ${TOLERANCE}) / 100")
+    if(new_us GREATER limit_us)
+        message(WARNING "bench_check: frame ${stat} ${new_us} us, riferimento ${base_us} us (+${TOLERANCE}% ammesso)")
+        set(failed TRUE)
+    else()
+        message(STATUS "bench_check: frame ${stat} ${new_us} us, riferimento ${base_us} us")
+    endif()
+endforeach()
+
+if(failed)
+    message(FATAL_ERROR "bench_check: prestazioni peggiorate rispetto a ${BASELINE}")
+endif()
@@ -0,0 +1,48 @@
+# Costo del rendering a piu' risoluzioni (cmake -P, dal target
+# bench_resolutions):
+#   SOURCE_DIR   sorgenti del progetto
+#   BUILD_ROOT   cartella delle build, una per risoluzione
+#   DATA_DIR     cartella che contiene ux0:data/ChexQuest con i WAD
+#   RESOLUTIONS  risoluzioni separate da virgole, es. 320x200,960x544
+#   CACHE_ARGS   opzioni in piu' per le build
+cmake_minimum_required(VERSION 3.21)
+
+string(REPLACE "," ";" resolutions "${RESOLUTIONS}")
+set(bench_json "${DATA_DIR}/ux0:data/ChexQuest/bench.json")
+set(summary "")
+
+foreach(res IN LISTS resolutions)
+    set(build_dir "${BUILD_ROOT}/${res}")
+
+    execute_process(
+        COMMAND ${CMAKE_COMMAND} -S ${SOURCE_DIR} -B ${build_dir}
+            -DVITA_HOST_BUILD=ON -DVITA_RESOLUTION=${res} ${CACHE_ARGS}
+        RESULT_VARIABLE result OUTPUT_QUIET)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "bench_resolutions: configurazione a ${res} fallita")
+    endif()
+
+    execute_process(
+        COMMAND ${CMAKE_COMMAND} --build ${build_dir} --target chexquest2_bench
+        RESULT_VARIABLE result OUTPUT_QUIET)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "bench_resolutions: build a ${res} fallita")
+    endif()
+
+    file(REMOVE "${bench_json}")
+    execute_process(
+        COMMAND ${build_dir}/chexquest2_bench -nopresent
+        WORKING_DIRECTORY ${DATA_DIR}
+        OUTPUT_QUIET ERROR_QUIET)
+    if(NOT EXISTS "${bench_json}")
+        message(FATAL_ERROR "bench_resolutions: ${res} non ha scritto ${bench_json}")
+    endif()
+
+    file(COPY_FILE "${bench_json}" "${BUILD_ROOT}/bench_${res}.json")
+    file(READ "${bench_json}" json)
+    string(JSON avg GET "${json}" total frame_ms avg)
+    string(JSON p99 GET "${json}" total frame_ms p99)
+    string(APPEND summary "\n  ${res}: frame medio ${avg} ms, p99 ${p99} ms")
+endforeach()
+
+message(STATUS "bench_resolutions (risultati in ${BUILD_ROOT}):${summary}")
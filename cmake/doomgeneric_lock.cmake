@@ -0,0 +1,34 @@
+# Aggiorna doomgeneric.lock, la base delle sostituzioni di engine/ (cmake -P,
+# a mano, poi si fa il commit del lock):
+#   REF  commit, ramo o tag di doomgeneric da fissare (predefinito master)
+# Un ramo o un tag viene risolto nell'hash completo con git ls-remote.
+cmake_minimum_required(VERSION 3.21)
+
+set(DOOMGENERIC_REPOSITORY https://github.com/ozkl/doomgeneric.git)
+set(LOCK_FILE "${CMAKE_CURRENT_LIST_DIR}/../doomgeneric.lock")
+
+if(NOT DEFINED REF)
+    set(REF master)
+endif()
+
+string(REPEAT "[0-9a-f]" 40 hash_regex)
+if(REF MATCHES "^${hash_regex}$")
+    set(commit "${REF}")
+else()
+    find_package(Git REQUIRED)
+    execute_process(
+        COMMAND ${GIT_EXECUTABLE} ls-remote ${DOOMGENERIC_REPOSITORY} ${REF}
+        OUTPUT_VARIABLE refs
+        RESULT_VARIABLE result
+    )
+    string(REGEX MATCH "^${hash_regex}" commit "${refs}")
+    if(NOT result EQUAL 0 OR NOT commit)
+        message(FATAL_ERROR "doomgeneric_lock: ${REF} non trovato in ${DOOMGENERIC_REPOSITORY}")
+    endif()
+endif()
+
+file(WRITE "${LOCK_FILE}"
+    "# Commit di doomgeneric su cui sono scritte e provate le sostituzioni di\n"
+    "# engine/. Si aggiorna con cmake -DREF=<commit> -P cmake/doomgeneric_lock.cmake\n"
+    "${commit}\n")
+message(STATUS "doomgeneric_lock: base fissata a ${commit} (${REF})")
@@ -1,141 +1,785 @@
 #include "doomgeneric.h"
-#include <psp2/ctrl.h>
-#include <psp2/rtc.h>
+#include "i_system.h"
+#include "i_timer.h"
+#include "m_argv.h"
+#include <psp2/display.h>
 #include <psp2/kernel/processmgr.h>
+#include <psp2/kernel/threadmgr.h>
 #include <vita2d.h>
 #include <string.h>
+#include <strings.h>
 #include <stdlib.h>
 
-#define QUEUE_SIZE 64
+#ifdef CMAP256
+#include "doomtype.h"
+#endif
 
-static int key_queue[QUEUE_SIZE];
-static int pressed_queue[QUEUE_SIZE];
-static int queue_head = 0;
-static int queue_tail = 0;
+#ifdef VITA_INTERPOLATION
+#include "vita_interp.h"
+#endif
+#ifdef VITA_RENDER_WORKERS
+#include "vita_rthreads.h"
+#endif
+#ifdef VITA_PREFETCH
+#include "vita_prefetch.h"
+#endif
+#ifdef VITA_STARTUP
+#include "vita_startup.h"
+#endif
+#ifdef VITA_POWER
+#include "vita_power.h"
+#endif
+#ifdef VITA_SAVE
+#include "vita_save.h"
+#endif
+#include "vita_config.h"
+#include "vita_input.h"
+#include "vita_prof.h"
+#ifdef VITA_BENCH
+#include "vita_bench.h"
+#endif
 
-static SceCtrlData old_pad;
-static vita2d_texture *frame_tex;
+#if defined(VITA_NEON_CONVERT) && defined(__ARM_NEON) && !defined(CMAP256)
+#include <arm_neon.h>
+#define USE_NEON_CONVERT 1
+#endif
 
-// Struttura per mappare i tasti Vita ai tasti di Doom
-struct ButtonMap {
-    uint32_t vita_btn;
-    unsigned char doom_key;
+// I_FinishUpdate replica i pixel 320x200 del motore di un fattore intero,
+// min(RESX / 320, RESY / 200), e centra l'immagine in orizzontale lasciando
+// vuoto il fondo: a 960x544 e' 640x400 da x = 160. Si disegna solo quella.
+#define FRAME_SCALE (DOOMGENERIC_RESX / 320 < DOOMGENERIC_RESY / 200 ? \
+                     DOOMGENERIC_RESX / 320 : DOOMGENERIC_RESY / 200)
+#define FRAME_W (320 * FRAME_SCALE)
+#define FRAME_H (200 * FRAME_SCALE)
+#define FRAME_X ((DOOMGENERIC_RESX - FRAME_W) / 2)
+
+#if FRAME_SCALE < 1
+#error "DOOMGENERIC_RESX/RESY devono essere almeno 320x200"
+#endif
+
+// Numero di texture del frame usate a rotazione (impostabile da CMake)
+#ifndef FRAME_RING_DEPTH
+#define FRAME_RING_DEPTH 3
+#endif
+
+#if FRAME_RING_DEPTH < 1 || FRAME_RING_DEPTH > 4
+#error "FRAME_RING_DEPTH deve essere tra 1 e 4"
+#endif
+
+// Con il thread di rendering servono almeno una texture in scrittura, una
+// in coda e una in presentazione.
+#if defined(VITA_RENDER_THREAD) && FRAME_RING_DEPTH < 3
+#error "VITA_RENDER_THREAD richiede FRAME_RING_DEPTH >= 3"
+#endif
+
+// vita2d accoda al massimo 2 swap: quando vita2d_swap_buffers ritorna per il
+// frame N, la GPU ha finito con le texture usate nel frame N-2 o prima. Con
+// un anello di 2 l'altra texture e' sempre quella del frame N-1, quindi ogni
+// frame aspetta la GPU: senza attese ne servono almeno 3.
+#define FRAME_GPU_PENDING 2
+
+// Base dei tempi: sceKernelGetProcessTimeWide e' monotono e in microsecondi,
+// lo catturiamo una volta all'avvio cosi' DG_GetTicksMs parte da zero.
+static SceUInt64 time_base = 0;
+
+// Stima di quanto sceKernelDelayThread dorme oltre il richiesto
+static uint32_t sleep_overshoot_us = 200;
+#define SLEEP_SPIN_US 100       // margine in spin oltre all'overshoot
+#define SLEEP_SPIN_MAX_US 200   // spin massimo, qualunque sia la stima
+
+#if defined(__arm__)
+#define cpu_relax() __asm__ volatile("yield")
+#else
+#define cpu_relax() do { } while (0)
+#endif
+
+// Modalita' di presentazione (-present vsync|novsync|paced)
+enum PresentMode {
+    PRESENT_VSYNC,      // swap bloccante sul vblank (default)
+    PRESENT_NOVSYNC,    // swap senza attesa, minima latenza
+    PRESENT_PACED       // ogni tic mostrato al suo vblank, cadenza regolare
 };
 
-// Mappatura tasti
-static const struct ButtonMap bmap[] = {
-    {SCE_CTRL_UP, KEY_UPARROW},
-    {SCE_CTRL_DOWN, KEY_DOWNARROW},
-    {SCE_CTRL_LEFT, KEY_LEFTARROW},
-    {SCE_CTRL_RIGHT, KEY_RIGHTARROW},
-    {SCE_CTRL_CROSS, KEY_RCTRL},       // Spara (Zorch)
-    {SCE_CTRL_SQUARE, ' '},            // Usa/Azione
-    {SCE_CTRL_CIRCLE, KEY_ESCAPE},     // Menu / Indietro
-    {SCE_CTRL_TRIANGLE, KEY_ENTER},    // Conferma
-    {SCE_CTRL_LTRIGGER, ','},          // Strafe Sinistra
-    {SCE_CTRL_RTRIGGER, '.'},          // Strafe Destra
-    {SCE_CTRL_START, KEY_ESCAPE},      // Pausa / Menu
-    {SCE_CTRL_SELECT, KEY_TAB}         // Mappa
+static enum PresentMode present_mode = PRESENT_VSYNC;
+
+// Preset di scala (-scale stretch|integer|aspect|sharp), tutti sulla GPU
+enum ScaleMode {
+    SCALE_STRETCH,      // schermo intero 960x544, come in origine
+    SCALE_INTEGER,      // massimo fattore intero che entra, filtro point, bande nere
+    SCALE_ASPECT,       // 4:3 corretto, filtro bilineare
+    SCALE_SHARP         // prescala intera (point) + bilineare fino al 4:3
 };
 
-// Aggiunge un evento tasto alla coda circolare
-static void add_key(int key, int pressed) {
-    int next_head = (queue_head + 1) % QUEUE_SIZE;
-    if (next_head != queue_tail) { // Evita l'overflow
-        key_queue[queue_head] = key;
-        pressed_queue[queue_head] = pressed;
-        queue_head = next_head;
+#define SCREEN_W 960
+#define SCREEN_H 544
+
+static enum ScaleMode scale_mode = SCALE_STRETCH;
+static float draw_x, draw_y, draw_sx, draw_sy;  // posizione/scala finali
+static vita2d_texture *sharp_rt = NULL;          // destinazione della prescala
+static int sharp_factor = 1;
+static int paced_base_tic = -1;
+static unsigned int paced_base_vcount = 0;
+
+// Una texture dell'anello e il numero del frame in cui e' stata disegnata
+struct FrameSlot {
+    vita2d_texture *tex;
+    pixel_t *pixels;    // dove il motore scrive il frame di questa texture
+    uint32_t seq;
+    int tic;            // tic di gioco del frame (per PRESENT_PACED)
+    int queued;         // 1 = consegnata al thread di rendering
+#ifdef CMAP256
+    uint32_t pal_gen;   // versione della palette caricata in questa texture
+#endif
+};
+
+static struct FrameSlot frame_ring[FRAME_RING_DEPTH];
+static int frame_slot = 0;      // texture in cui si scrive il prossimo frame
+static uint32_t frame_seq = 0;  // frame inviati alla GPU
+static int zero_copy = 0; // 1 = il motore scrive direttamente nella texture
+
+#ifdef VITA_RENDER_THREAD
+// Passaggio dei frame al thread di rendering: un solo slot lock-free, il
+// gioco ci scrive l'indice dell'ultimo frame completo (quello precedente non
+// ancora preso viene scartato), il thread di rendering lo svuota.
+static int pending_slot = -1;
+static SceUID frame_sema = -1;
+static SceUID render_thread = -1;
+#endif
+
+#ifdef CMAP256
+// Palette di i_video.c: con CMAP256 il motore la espone e segnala i cambi
+// (flash di danno/raccolta) tramite palette_changed.
+struct color {
+    uint32_t b:8;
+    uint32_t g:8;
+    uint32_t r:8;
+    uint32_t a:8;
+};
+
+extern struct color colors[256];
+extern boolean palette_changed;
+
+static uint32_t cur_palette[256];
+static uint32_t palette_gen = 0;
+#endif
+
+#ifndef CMAP256
+// Converte i pixel di doomgeneric (0x00RRGGBB, in memoria B,G,R,X) nel
+// formato ABGR della texture di Vita2D (in memoria R,G,B,A) con alfa a 0xFF.
+static void convert_pixels(uint32_t *dst, const uint32_t *src, int count) {
+    int i = 0;
+
+#ifdef USE_NEON_CONVERT
+    // 16 pixel per iterazione: vld4 separa i quattro canali, scambiamo
+    // R con B e sostituiamo il byte inutilizzato con l'alfa pieno.
+    const uint8x16_t alpha = vdupq_n_u8(0xFF);
+
+    for (; i + 16 <= count; i += 16) {
+        uint8x16x4_t in = vld4q_u8((const uint8_t *)(src + i));
+        uint8x16x4_t out;
+
+        out.val[0] = in.val[2];
+        out.val[1] = in.val[1];
+        out.val[2] = in.val[0];
+        out.val[3] = alpha;
+        vst4q_u8((uint8_t *)(dst + i), out);
+    }
+#endif
+
+    // Percorso scalare: fallback senza NEON e coda degli ultimi pixel
+    for (; i < count; i++) {
+        uint32_t c = src[i];
+        uint8_t r = (c >> 16) & 0xFF;
+        uint8_t g = (c >> 8)  & 0xFF;
+        uint8_t b = c & 0xFF;
+        dst[i] = RGBA8(r, g, b, 255);
+    }
+}
+#else
+// Converte i 256 colori di i_video.c in una nuova versione della palette:
+// la GPU espande gli indici, per frame carichiamo solo 64 KB di pixel e
+// 1 KB di palette per texture quando cambia.
+static void update_palette(void) {
+    for (int i = 0; i < 256; i++)
+        cur_palette[i] = RGBA8(colors[i].r, colors[i].g, colors[i].b, 255);
+    palette_gen++;
+}
+#endif
+
+// Crea una texture dell'anello. Ritorna 1 se il motore puo' scriverci
+// direttamente (righe contigue, stesso formato di DG_ScreenBuffer).
+static int create_frame_slot(struct FrameSlot *slot) {
+    int direct = 0;
+
+#if defined(CMAP256)
+    // Percorso a 8 bit: il motore copia I_VideoBuffer (indici di palette)
+    // direttamente in una texture P8, la palette viene aggiornata a parte.
+    slot->tex = vita2d_create_empty_texture_format(DOOMGENERIC_RESX, DOOMGENERIC_RESY,
+                                                   SCE_GXM_TEXTURE_FORMAT_P8_ABGR);
+    direct = slot->tex && vita2d_texture_get_stride(slot->tex) == DOOMGENERIC_RESX;
+    slot->pal_gen = 0;
+#elif defined(VITA_ZERO_COPY)
+    // Texture con lo stesso layout di doomgeneric (0x00RRGGBB, byte alto
+    // ignorato dalla GPU): DG_ScreenBuffer punta direttamente alla sua memoria
+    // e DG_DrawFrame non deve piu' copiare/convertire nulla. La memoria della
+    // texture non e' in cache, ma I_FinishUpdate la scrive solo in sequenza.
+    slot->tex = vita2d_create_empty_texture_format(DOOMGENERIC_RESX, DOOMGENERIC_RESY,
+                                                   SCE_GXM_TEXTURE_FORMAT_X8U8U8U8_1RGB);
+
+    // Serve che le righe siano contigue (vita2d allinea la larghezza a 8)
+    direct = slot->tex && vita2d_texture_get_stride(slot->tex) == DOOMGENERIC_RESX * 4;
+    if (slot->tex && !direct) {
+        vita2d_free_texture(slot->tex);
+        slot->tex = NULL;
+    }
+#endif
+
+#ifndef CMAP256
+    // Texture del percorso con conversione
+    if (!slot->tex)
+        slot->tex = vita2d_create_empty_texture(DOOMGENERIC_RESX, DOOMGENERIC_RESY);
+#endif
+
+    // Senza VRAM per l'anello DG_DrawFrame non avrebbe dove disegnare
+    if (!slot->tex)
+        I_Error("DG_Init: cannot allocate a %dx%d frame texture",
+                DOOMGENERIC_RESX, DOOMGENERIC_RESY);
+
+    slot->seq = 0;
+    return direct;
+}
+
+// Una texture e' libera se non e' in mano al thread di rendering e la GPU
+// ha gia' finito di campionarla (vedi FRAME_GPU_PENDING).
+static int frame_slot_busy(const struct FrameSlot *slot) {
+    uint32_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+
+    if (__atomic_load_n(&slot->queued, __ATOMIC_ACQUIRE))
+        return 1;
+
+    return seq != 0 && (int32_t)(__atomic_load_n(&frame_seq, __ATOMIC_ACQUIRE) - seq) < FRAME_GPU_PENDING;
+}
+
+// Passa alla prossima texture libera dell'anello, aspettando la GPU solo se
+// l'anello e' troppo corto perche' abbia gia' finito di campionarla.
+static void acquire_frame_slot(void) {
+    int next = frame_slot;
+    int n;
+    PROF_BEGIN(wait_start);
+
+    for (;;) {
+        for (n = 0; n < FRAME_RING_DEPTH; n++) {
+            next = (next + 1) % FRAME_RING_DEPTH;
+            if (!frame_slot_busy(&frame_ring[next]))
+                break;
+        }
+        if (n < FRAME_RING_DEPTH)
+            break;
+
+#ifdef VITA_RENDER_THREAD
+        if (render_thread >= 0) {
+            // Tutte in uso: il prossimo swap del thread di rendering ne libera una
+            sceKernelDelayThread(500);
+            continue;
+        }
+#endif
+        vita2d_wait_rendering_done();
+        next = (frame_slot + 1) % FRAME_RING_DEPTH;
+        break;
+    }
+
+    frame_slot = next;
+    DG_ScreenBuffer = frame_ring[next].pixels;
+    PROF_END(PROF_SWAP, wait_start);
+}
+
+// PRESENT_PACED: il display va a 60 Hz e i tic a 35 Hz. Invece di mostrare
+// il frame al primo vblank dopo che e' pronto (cadenza irregolare), lo
+// mostriamo al vblank che corrisponde all'inizio del suo tic, cosi' lo schema
+// 2-1-2-1-... dei vblank resta fisso. Se siamo troppo in ritardo o in anticipo
+// (vblank a 59.94 Hz, frame lenti) ci riagganciamo al vblank corrente.
+static void wait_paced_vblank(int tic) {
+    unsigned int now = sceDisplayGetVcount();
+    int ahead;
+
+    if (paced_base_tic < 0 || tic < paced_base_tic) {
+        paced_base_tic = tic;
+        paced_base_vcount = now;
+    }
+
+    unsigned int target = paced_base_vcount + ((tic - paced_base_tic) * 60 + TICRATE - 1) / TICRATE;
+    ahead = (int)(target - now);
+
+    if (ahead < -1 || ahead > 4) {
+        paced_base_tic = tic;
+        paced_base_vcount = now;
+        return;
+    }
+
+    while ((int)(target - sceDisplayGetVcount()) > 0)
+        sceDisplayWaitVblankStart();
+}
+
+// Converte (se serve), disegna e presenta una texture completa
+static void present_frame_slot(struct FrameSlot *slot) {
+    PROF_BEGIN(convert_start);
+
+#ifdef CMAP256
+    // Indici a 8 bit: se la texture ha righe con padding le copiamo una a una
+    if (!zero_copy) {
+        uint8_t *tex_data = (uint8_t *)vita2d_texture_get_datap(slot->tex);
+        unsigned int stride = vita2d_texture_get_stride(slot->tex);
+
+        for (int y = 0; y < FRAME_H; y++)
+            memcpy(tex_data + y * stride, slot->pixels + y * DOOMGENERIC_RESX, DOOMGENERIC_RESX);
+    }
+#else
+    // Doomgeneric genera colori nel formato 0x00RRGGBB.
+    // Dobbiamo convertirli per la texture di Vita2D (tipicamente ABGR su PS Vita).
+    // In modalita' zero-copy il frame e' gia' nella texture. Le righe sotto
+    // FRAME_H il motore non le scrive mai.
+    if (!zero_copy) {
+        uint32_t *tex_data = (uint32_t *)vita2d_texture_get_datap(slot->tex);
+
+        convert_pixels(tex_data, slot->pixels, DOOMGENERIC_RESX * FRAME_H);
+    }
+#endif
+
+    PROF_END(PROF_CONVERT, convert_start);
+    PROF_BEGIN(draw_start);
+
+    if (scale_mode == SCALE_SHARP) {
+        // Prima passata: ingrandimento intero con filtro point nella render
+        // target, poi bilineare solo per l'ultimo fattore non intero.
+        vita2d_start_drawing_advanced(sharp_rt, SCE_GXM_SCENE_FRAGMENT_SET_DEPENDENCY);
+        vita2d_draw_texture_part_scale(slot->tex, 0, 0, FRAME_X, 0, FRAME_W, FRAME_H,
+                                       sharp_factor, sharp_factor);
+        vita2d_end_drawing();
+
+        vita2d_start_drawing_advanced(NULL, SCE_GXM_SCENE_VERTEX_WAIT_FOR_DEPENDENCY);
+        vita2d_clear_screen();
+        vita2d_draw_texture_scale(sharp_rt, draw_x, draw_y, draw_sx, draw_sy);
+    } else {
+        vita2d_start_drawing();
+        vita2d_clear_screen();
+        vita2d_draw_texture_part_scale(slot->tex, draw_x, draw_y, FRAME_X, 0, FRAME_W, FRAME_H,
+                                       draw_sx, draw_sy);
     }
+
+#ifdef VITA_PROFILER
+    vita_prof_draw_overlay();
+#endif
+
+    vita2d_end_drawing();
+    PROF_END(PROF_DRAW, draw_start);
+    PROF_BEGIN(swap_start);
+
+    if (present_mode == PRESENT_PACED)
+        wait_paced_vblank(slot->tic);
+    vita2d_swap_buffers();
+
+    PROF_END(PROF_SWAP, swap_start);
+#ifdef VITA_PROFILER
+    vita_prof_end_frame();
+#endif
+
+    __atomic_store_n(&slot->seq, frame_seq + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&frame_seq, frame_seq + 1, __ATOMIC_RELEASE);
+}
+
+#ifdef VITA_RENDER_THREAD
+// Thread di rendering: conversione, disegno e swap (bloccante sul vsync)
+// mentre il thread del gioco simula gia' il tic successivo.
+static int render_thread_main(SceSize args, void *argp) {
+    for (;;) {
+        sceKernelWaitSema(frame_sema, 1, NULL);
+
+        int i = __atomic_exchange_n(&pending_slot, -1, __ATOMIC_ACQ_REL);
+        if (i < 0)
+            continue;
+
+        present_frame_slot(&frame_ring[i]);
+        __atomic_store_n(&frame_ring[i].queued, 0, __ATOMIC_RELEASE);
+    }
+
+    return 0;
+}
+
+// Consegna la texture appena scritta al thread di rendering
+static void publish_frame_slot(int i) {
+    __atomic_store_n(&frame_ring[i].queued, 1, __ATOMIC_RELEASE);
+
+    int dropped = __atomic_exchange_n(&pending_slot, i, __ATOMIC_ACQ_REL);
+    if (dropped >= 0) // Il thread di rendering e' rimasto indietro
+        __atomic_store_n(&frame_ring[dropped].queued, 0, __ATOMIC_RELEASE);
+
+    sceKernelSignalSema(frame_sema, 1);
+}
+
+static void start_render_thread(void) {
+    frame_sema = sceKernelCreateSema("cq_frame", 0, 0, 1, NULL);
+
+    // Il gioco resta sul core 0, il rendering va sul core 1
+    sceKernelChangeThreadCpuAffinityMask(sceKernelGetThreadId(), SCE_KERNEL_CPU_MASK_USER_0);
+    render_thread = sceKernelCreateThread("cq_render", render_thread_main, 0x10000100,
+                                          0x10000, 0, SCE_KERNEL_CPU_MASK_USER_1, NULL);
+    if (render_thread >= 0)
+        sceKernelStartThread(render_thread, 0, NULL);
+}
+#endif
+
+// Modalita' di presentazione da vita.cfg o dalla riga di comando
+static void parse_present_mode(void) {
+    if (!strcasecmp(vita_config.present, "novsync"))
+        present_mode = PRESENT_NOVSYNC;
+    else if (!strcasecmp(vita_config.present, "paced"))
+        present_mode = PRESENT_PACED;
+    else
+        present_mode = PRESENT_VSYNC;
+}
+
+// Preset di scala da vita.cfg o dalla riga di comando
+static void parse_scale_mode(void) {
+    if (!strcasecmp(vita_config.scale, "integer"))
+        scale_mode = SCALE_INTEGER;
+    else if (!strcasecmp(vita_config.scale, "aspect"))
+        scale_mode = SCALE_ASPECT;
+    else if (!strcasecmp(vita_config.scale, "sharp"))
+        scale_mode = SCALE_SHARP;
+    else
+        scale_mode = SCALE_STRETCH;
+}
+
+// Calcola posizione, scala e filtri del preset scelto. Il frame di Doom
+// (8:5) va mostrato in 4:3, come sui monitor CRT dell'epoca.
+static void setup_scaling(void) {
+    float aspect_w = SCREEN_H * 4.0f / 3.0f;
+    SceGxmTextureFilter filter = SCE_GXM_TEXTURE_FILTER_LINEAR;
+
+    if (scale_mode == SCALE_SHARP) {
+        // Il piu' piccolo fattore intero che copre l'altezza dello schermo
+        sharp_factor = (SCREEN_H + FRAME_H - 1) / FRAME_H;
+        sharp_rt = vita2d_create_empty_texture_rendertarget(FRAME_W * sharp_factor,
+                                                            FRAME_H * sharp_factor,
+                                                            SCE_GXM_TEXTURE_FORMAT_A8B8G8R8);
+        if (sharp_rt == NULL) {
+            scale_mode = SCALE_ASPECT;
+        } else {
+            vita2d_texture_set_filters(sharp_rt, SCE_GXM_TEXTURE_FILTER_LINEAR,
+                                       SCE_GXM_TEXTURE_FILTER_LINEAR);
+            filter = SCE_GXM_TEXTURE_FILTER_POINT;
+            draw_sx = aspect_w / (FRAME_W * sharp_factor);
+            draw_sy = (float)SCREEN_H / (FRAME_H * sharp_factor);
+            draw_x = (SCREEN_W - aspect_w) / 2;
+            draw_y = 0;
+        }
+    }
+
+    switch (scale_mode) {
+    case SCALE_INTEGER: {
+        // 3x non entra in altezza (600 > 544): a 320x200 il fattore e' 2
+        int k = SCREEN_W / FRAME_W;
+        if (SCREEN_H / FRAME_H < k)
+            k = SCREEN_H / FRAME_H;
+        if (k < 1)
+            k = 1;
+
+        filter = SCE_GXM_TEXTURE_FILTER_POINT;
+        draw_sx = draw_sy = k;
+        draw_x = (SCREEN_W - FRAME_W * k) / 2;
+        draw_y = (SCREEN_H - FRAME_H * k) / 2;
+        break;
+    }
+    case SCALE_ASPECT:
+        draw_sx = aspect_w / FRAME_W;
+        draw_sy = (float)SCREEN_H / FRAME_H;
+        draw_x = (SCREEN_W - aspect_w) / 2;
+        draw_y = 0;
+        break;
+    case SCALE_SHARP:
+        break;
+    default:
+        // Scala l'immagine originale alla risoluzione PS Vita (960x544)
+        // es. 960 / 320 = 3.0f  |  544 / 200 = 2.72f
+        draw_sx = (float)SCREEN_W / FRAME_W;
+        draw_sy = (float)SCREEN_H / FRAME_H;
+        draw_x = draw_y = 0;
+        break;
+    }
+
+    // In SCALE_STRETCH restano i filtri predefiniti di vita2d
+    if (scale_mode == SCALE_STRETCH)
+        return;
+
+    for (int i = 0; i < FRAME_RING_DEPTH; i++)
+        vita2d_texture_set_filters(frame_ring[i].tex, filter, filter);
 }
 
 void DG_Init() {
+    // vita.cfg e' gia' letto: qui si aggiungono i parametri di avvio
+    vita_config_apply_args();
+
     // Inizializza Vita2D
     vita2d_init();
     vita2d_set_clear_color(RGBA8(0, 0, 0, 255));
+
+    // Solo PRESENT_VSYNC blocca lo swap: PRESENT_PACED aspetta da se' il vblank
+    // giusto, PRESENT_NOVSYNC non aspetta affatto (il flip avviene comunque al
+    // vblank successivo, quindi senza tearing).
+    parse_present_mode();
+
+#ifdef VITA_INTERPOLATION
+    // I frame interpolati sono scanditi dal vsync: PRESENT_PACED mostra
+    // solo un frame per tic e non ha senso insieme a -interpolate.
+    vita_interp_init();
+    if (vita_interp_enabled && present_mode == PRESENT_PACED)
+        present_mode = PRESENT_VSYNC;
+#endif
+
+#ifdef VITA_RENDER_WORKERS
+    vita_rthreads_init();
+#endif
+
+#ifdef VITA_PREFETCH
+    vita_prefetch_init();
+#endif
+
+#ifdef VITA_PROFILER
+    vita_prof_init();
+#endif
+
+#ifdef VITA_BENCH
+    vita_bench_init();
+#endif
+
+#ifdef VITA_POWER
+    vita_power_init();
+#endif
+
+#ifdef VITA_SAVE
+    vita_save_init();
+#endif
+
+    vita2d_set_vblank_wait(present_mode == PRESENT_VSYNC);
     
-    // Crea una texture delle dimensioni di Doom (320x200)
-    frame_tex = vita2d_create_empty_texture(DOOMGENERIC_RESX, DOOMGENERIC_RESY);
+    // Crea l'anello di texture delle dimensioni di Doom
+    zero_copy = 1;
+    for (int i = 0; i < FRAME_RING_DEPTH; i++)
+        zero_copy &= create_frame_slot(&frame_ring[i]);
+
+    // Dove scrive il motore: la texture stessa, oppure DG_ScreenBuffer da
+    // convertire (uno per texture se la conversione avviene su un altro thread)
+    for (int i = 0; i < FRAME_RING_DEPTH; i++) {
+        if (zero_copy)
+            frame_ring[i].pixels = (pixel_t *)vita2d_texture_get_datap(frame_ring[i].tex);
+#ifdef VITA_RENDER_THREAD
+        else if (i > 0)
+            frame_ring[i].pixels = malloc(DOOMGENERIC_RESX * DOOMGENERIC_RESY * sizeof(pixel_t));
+#endif
+        else
+            frame_ring[i].pixels = DG_ScreenBuffer;
+    }
+
+    if (zero_copy)
+        free(DG_ScreenBuffer);
+    DG_ScreenBuffer = frame_ring[0].pixels;
     
-    // Inizializza il pad
-    sceCtrlSetSamplingMode(SCE_CTRL_MODE_ANALOG);
-    sceCtrlPeekBufferPositive(0, &old_pad, 1);
+    parse_scale_mode();
+    setup_scaling();
+
+    vita_input_init();
+
+#ifdef VITA_RENDER_THREAD
+    start_render_thread();
+#endif
 }
 
 void DG_DrawFrame() {
-    // Doomgeneric genera colori nel formato 0x00RRGGBB.
-    // Dobbiamo convertirli per la texture di Vita2D (tipicamente ABGR su PS Vita)
-    uint32_t *tex_data = (uint32_t *)vita2d_texture_get_datap(frame_tex);
-    
-    for (int i = 0; i < DOOMGENERIC_RESX * DOOMGENERIC_RESY; i++) {
-        uint32_t c = DG_ScreenBuffer[i];
-        uint8_t r = (c >> 16) & 0xFF;
-        uint8_t g = (c >> 8)  & 0xFF;
-        uint8_t b = c & 0xFF;
-        tex_data[i] = RGBA8(r, g, b, 255);
+    frame_ring[frame_slot].tic = I_GetTime();
+
+#ifdef VITA_STARTUP
+    vita_startup_frame();
+#endif
+
+#ifdef VITA_BENCH
+    // DG_DrawFrame nullo: lo stesso buffer viene riscritto a ogni frame
+    if (vita_bench_nopresent)
+        return;
+#endif
+
+#ifdef CMAP256
+    struct FrameSlot *slot = &frame_ring[frame_slot];
+
+    // La palette si aggiorna sul thread del gioco: la texture e' ancora sua
+    if (palette_changed || palette_gen == 0) {
+        update_palette();
+        palette_changed = false;
     }
 
-    vita2d_start_drawing();
-    vita2d_clear_screen();
-    
-    // Scala l'immagine originale (320x200) alla risoluzione PS Vita (960x544)
-    // 960 / 320 = 3.0f  |  544 / 200 = 2.72f
-    vita2d_draw_texture_scale(frame_tex, 0, 0, 3.0f, 2.72f);
-    
-    vita2d_end_drawing();
-    vita2d_swap_buffers();
+    // Ogni texture ha la sua palette: la ricarichiamo solo se e' vecchia
+    if (slot->pal_gen != palette_gen) {
+        memcpy(vita2d_texture_get_palette(slot->tex), cur_palette, sizeof(cur_palette));
+        slot->pal_gen = palette_gen;
+    }
+#endif
+
+#ifdef VITA_RENDER_THREAD
+    if (render_thread >= 0) {
+        publish_frame_slot(frame_slot);
+        acquire_frame_slot();
+        return;
+    }
+#endif
+
+    present_frame_slot(&frame_ring[frame_slot]);
+    acquire_frame_slot();
 }
 
+static void init_time_base(void) {
+    if (time_base == 0)
+        time_base = sceKernelGetProcessTimeWide();
+}
+
+// Microsecondi dall'avvio
+static SceUInt64 time_us(void) {
+    return sceKernelGetProcessTimeWide() - time_base;
+}
+
+// Attesa ibrida: sceKernelDelayThread per la parte lunga, corretto con la
+// stima dell'overshoot dello scheduler, poi spin fino alla scadenza esatta.
+// Lo spin non supera SLEEP_SPIN_MAX_US: con una stima alta si dorme di nuovo
+// e il risveglio puo' arrivare un po' dopo la scadenza. Con PRESENT_VSYNC
+// il loop lo scandisce gia' lo swap, e basta dormire.
 void DG_SleepMs(uint32_t ms) {
-    sceKernelDelayThread(ms * 1000);
+    SceUInt64 target = time_us() + (SceUInt64)ms * 1000;
+    SceUInt64 now = time_us();
+
+    if (present_mode == PRESENT_VSYNC) {
+        if (target > now)
+            sceKernelDelayThread((uint32_t)(target - now));
+        return;
+    }
+
+    while (target > now + SLEEP_SPIN_MAX_US) {
+        uint32_t margin = sleep_overshoot_us + SLEEP_SPIN_US;
+        uint32_t req;
+        SceUInt64 before = now;
+
+        if (margin > SLEEP_SPIN_MAX_US)
+            margin = SLEEP_SPIN_MAX_US;
+        req = (uint32_t)(target - now) - margin;
+
+        sceKernelDelayThread(req);
+        now = time_us();
+
+        // Media mobile (1/8) dell'overshoot misurato
+        int32_t over = (int32_t)(now - before) - (int32_t)req;
+        if (over < 0)
+            over = 0;
+        else if (over > 2000) // Preemption occasionale: non falsa la stima
+            over = 2000;
+        sleep_overshoot_us = (sleep_overshoot_us * 7 + (uint32_t)over) / 8;
+    }
+
+    while (time_us() < target)
+        cpu_relax();
 }
 
 uint32_t DG_GetTicksMs() {
-    SceRtcTick tick;
-    sceRtcGetCurrentTick(&tick);
-    return (uint32_t)(tick.tick / 1000); // tick è in microsecondi
+    // 32 bit di millisecondi dall'avvio: il wrap arriva dopo ~49 giorni
+    return (uint32_t)(time_us() / 1000);
 }
 
 int DG_GetKey(int* pressed, unsigned char* key) {
-    if (queue_tail == queue_head) return 0; // Coda vuota
-    
-    *key = key_queue[queue_tail];
-    *pressed = pressed_queue[queue_tail];
-    queue_tail = (queue_tail + 1) % QUEUE_SIZE;
-    
+    input_event_t ev;
+
+    if (!vita_input_pop_batch(&ev, 1))
+        return 0;
+
+    *key = INPUT_EVENT_KEY(ev);
+    *pressed = INPUT_EVENT_PRESSED(ev);
     return 1;
 }
 
+// Tutti gli eventi pronti in una chiamata (engine/i_input_vita.c)
+int DG_GetKeys(input_event_t *events, int max) {
+    return vita_input_pop_batch(events, max);
+}
+
 void DG_SetWindowTitle(const char * title) {
     // Non necessario su console
 }
 
 int main(int argc, char **argv) {
-    // Parametri hardcoded per avviare Chex Quest 2.
-    // Modifica le path se preferisci cartelle diverse sulla Vita.
-    char *cq_argv[] = {
-        "doom", 
-        "-iwad", "ux0:data/ChexQuest/chex.wad", 
-        "-file", "ux0:data/ChexQuest/chex2.wad"
-    };
+    init_time_base();
+
+    // WAD da vita.cfg; eventuali parametri passati all'avvio (es. -present
+    // paced) vanno in coda
+    vita_config_load();
+
+    int cq_argc = 0;
+    char **cq_argv = malloc((4 + VITA_CONFIG_MAX_FILES + argc) * sizeof(char *));
+
+    cq_argv[cq_argc++] = "doom";
+    cq_argv[cq_argc++] = "-iwad";
+    cq_argv[cq_argc++] = vita_config.iwad;
+    if (vita_config.num_files > 0) {
+        cq_argv[cq_argc++] = "-file";
+        for (int i = 0; i < vita_config.num_files; i++)
+            cq_argv[cq_argc++] = vita_config.files[i];
+    }
+    for (int i = 1; i < argc; i++)
+        cq_argv[cq_argc++] = argv[i];
+    cq_argv[cq_argc] = NULL;
+
+#ifdef VITA_BENCH
+    cq_argv = vita_bench_args(&cq_argc, cq_argv);
+#endif
     
-    doomgeneric_Create(5, cq_argv);
+#ifdef VITA_STARTUP
+    vita_startup_mark("doomgeneric_Create");
+#endif
+    doomgeneric_Create(cq_argc, cq_argv);
+
+#ifdef VITA_INTERPOLATION
+    int last_tic = -1;
+#endif
 
     while (1) {
-        SceCtrlData pad;
-        sceCtrlPeekBufferPositive(0, &pad, 1);
-
-        // Controlla variazioni di stato per ogni tasto
-        for (int i = 0; i < sizeof(bmap) / sizeof(bmap[0]); i++) {
-            int old_p = (old_pad.buttons & bmap[i].vita_btn) ? 1 : 0;
-            int new_p = (pad.buttons & bmap[i].vita_btn) ? 1 : 0;
-            
-            if (old_p != new_p) {
-                add_key(bmap[i].doom_key, new_p);
-            }
+        PROF_BEGIN(pad_start);
+        vita_input_poll();
+        PROF_END(PROF_PAD, pad_start);
+
+#ifdef VITA_INTERPOLATION
+        // Finche' non e' ora del prossimo tic presentiamo frame interpolati
+        // (al ritmo del display) invece di aspettare dentro TryRunTics.
+        if (I_GetTime() == last_tic && vita_interp_can_draw()) {
+            vita_interp_draw_frame();
+            continue;
         }
-        old_pad = pad;
+#endif
 
         doomgeneric_Tick();
+
+#ifdef VITA_INTERPOLATION
+        last_tic = I_GetTime();
+#endif
+
+#ifdef VITA_PREFETCH
+        vita_prefetch_tick();
+#endif
+
+#ifdef VITA_STARTUP
+        vita_startup_tick();
+#endif
+
+#ifdef VITA_POWER
+        vita_power_tick();
+#endif
+
+#ifdef VITA_BENCH
+        vita_bench_frame();
+#endif
     }
     
     vita2d_fini();
@@ -0,0 +1,105 @@
+// d_main.c di doomgeneric con l'avvio strumentato (vita_startup.c):
+//
+//  - i messaggi "X_Init: ..." di D_DoomMain passano da DEH_printf, che qui
+//    marca l'inizio di ogni fase prima di stamparli;
+//  - con -fastboot la riproduzione delle demo resta ferma per il primo giro
+//    della sequenza del titolo, cosi' il menu risponde subito invece di
+//    aspettare il caricamento del livello della demo. Il precache spento
+//    per il titolo torna com'era alla fine dell'attesa.
+//
+// Con VITA_SAVE i salvataggi vanno in ux0:data/ChexQuest/saves invece che
+// nella cartella di configurazione (vita_save.c).
+//
+// DEH_printf puo' essere una macro su printf o una funzione di deh_str.c a
+// seconda di FEATURE_DEHACKED: includendo prima deh_str.h la si ridefinisce
+// in entrambi i casi.
+
+#include "deh_str.h"
+
+#ifdef VITA_SAVE
+#include "vita_save.h"
+#define M_GetSaveGameDir(...) vita_save_dir(__VA_ARGS__)
+#endif
+
+#ifdef VITA_STARTUP
+void vita_startup_printf(char *fmt, ...);
+void vita_DeferedPlayDemo(char *demo);
+
+#undef DEH_printf
+#define DEH_printf vita_startup_printf
+#define G_DeferedPlayDemo(...) vita_DeferedPlayDemo(__VA_ARGS__)
+#define D_DoomMain D_DoomMain_Upstream
+#endif
+#include "d_main.c"
+#ifdef VITA_STARTUP
+#undef D_DoomMain
+#undef G_DeferedPlayDemo
+#undef DEH_printf
+#endif
+#ifdef VITA_SAVE
+#undef M_GetSaveGameDir
+#endif
+
+#ifdef VITA_STARTUP
+#include <ctype.h>
+#include <stdarg.h>
+
+#include "vita_startup.h"
+
+void D_DoomMain(void);
+void G_DeferedPlayDemo(char *demo);
+
+// Il nome della fase e' il prefisso "X_Init:" a inizio messaggio
+static void mark_phase(const char *fmt) {
+    char name[32];
+    int len = 0;
+
+    while (*fmt == '\n')
+        fmt++;
+
+    while (len < (int)sizeof(name) - 1 && (isalnum((unsigned char)fmt[len]) || fmt[len] == '_')) {
+        name[len] = fmt[len];
+        len++;
+    }
+
+    if (len == 0 || fmt[len] != ':')
+        return;
+
+    // Solo nomi di funzioni del motore: Z_Init, R_Init, D_CheckNetGame...
+    name[len] = '\0';
+    if (strchr(name, '_'))
+        vita_startup_mark(name);
+}
+
+void vita_startup_printf(char *fmt, ...) {
+    va_list args;
+
+    mark_phase(fmt);
+
+    va_start(args, fmt);
+    vprintf(DEH_String(fmt), args);
+    va_end(args);
+}
+
+static int demo_hold_sequence = -1;
+
+void vita_DeferedPlayDemo(char *demo) {
+    // Primo giro della sequenza: solo pagine, niente demo
+    if (vita_fastboot && demo_hold_sequence != -2) {
+        if (demosequence > demo_hold_sequence) {
+            demo_hold_sequence = demosequence;
+            return;
+        }
+        demo_hold_sequence = -2;
+        vita_startup_hold_done();
+    }
+
+    G_DeferedPlayDemo(demo);
+}
+
+void D_DoomMain(void) {
+    vita_startup_init();
+    vita_startup_mark("D_DoomMain");
+    D_DoomMain_Upstream();
+}
+#endif
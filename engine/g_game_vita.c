@@ -0,0 +1,128 @@
+// g_game.c di doomgeneric con quattro aggiunte per la Vita:
+//
+//  - G_Ticker misurata dal profilo dei frame (vita_prof.c);
+//  - i salvataggi (VITA_SAVE) passano da copie in RAM: fopen, fclose,
+//    remove e rename di G_DoSaveGame/G_DoLoadGame sono quelli di
+//    vita_save.c, e G_Ticker esegue salvataggio e caricamento rapido;
+//  - le levette analogiche (VITA_ANALOG) entrano direttamente nel ticcmd
+//    costruito da G_BuildTiccmd, in proporzione alla corsa;
+//  - con il benchmark acceso (VITA_BENCH e vita_bench_enabled) la fine di una -timedemo passa
+//    alla demo successiva invece di terminare con I_Error, e dopo l'ultima
+//    esce con i risultati in bench.json (vita_bench.c). La fine della demo
+//    si intercetta in G_Ticker, prima che G_ReadDemoTiccmd trovi il
+//    DEMOMARKER: la sua chiamata a G_CheckDemoStatus resta interna a
+//    g_game.c e un wrapper non la vedrebbe.
+
+#ifdef VITA_SAVE
+// Prima le dichiarazioni vere, poi le macro solo per le chiamate
+#include <stdio.h>
+#include "vita_save.h"
+#define fopen(...) vita_save_fopen(__VA_ARGS__)
+#define fclose(...) vita_save_fclose(__VA_ARGS__)
+#define remove(...) vita_save_remove(__VA_ARGS__)
+#define rename(...) vita_save_rename(__VA_ARGS__)
+#endif
+
+#define G_Ticker G_Ticker_Upstream
+#define G_BuildTiccmd G_BuildTiccmd_Upstream
+#include "g_game.c"
+#undef G_BuildTiccmd
+#undef G_Ticker
+
+#ifdef VITA_SAVE
+#undef rename
+#undef remove
+#undef fclose
+#undef fopen
+#endif
+
+#include "vita_prof.h"
+#ifdef VITA_BENCH
+#include "vita_bench.h"
+#endif
+#ifdef VITA_ANALOG
+#include "vita_input.h"
+#endif
+
+#ifdef VITA_SAVE
+// Stesse condizioni dei salvataggi rapidi del menu (M_QuickSave/M_QuickLoad)
+static void run_save_request(void) {
+    switch (vita_save_take_request()) {
+    case SAVE_REQUEST_QUICKSAVE:
+        if (usergame && gamestate == GS_LEVEL && gameaction == ga_nothing)
+            G_SaveGame(VITA_QUICKSAVE_SLOT, "QUICKSAVE");
+        break;
+
+    case SAVE_REQUEST_QUICKLOAD:
+        if (!netgame && gameaction == ga_nothing)
+            G_LoadGame(P_SaveGameFile(VITA_QUICKSAVE_SLOT));
+        break;
+
+    case SAVE_REQUEST_NONE:
+        break;
+    }
+}
+#endif
+
+#ifdef VITA_BENCH
+// Se la demo cronometrata e' finita passa alla successiva, oppure lascia che
+// G_CheckDemoStatus esca come con -playdemo dopo l'ultima
+static void run_bench_demo_end(void) {
+    char *next;
+
+    // ga_playdemo sostituisce demo_p prima della lettura dei ticcmd
+    if (!vita_bench_enabled || !timingdemo || !demoplayback || gameaction == ga_playdemo || *demo_p != DEMOMARKER)
+        return;
+
+    next = vita_bench_demo_done();
+    timingdemo = false;
+
+    if (next) {
+        // Il resto dello stato lo reimposta G_DoPlayDemo dall'header
+        W_ReleaseLumpName(defdemoname);
+        demoplayback = false;
+        G_TimeDemo(next);
+        return;
+    }
+
+    // Ripristino di upstream e poi I_Quit
+    singledemo = true;
+    G_CheckDemoStatus();
+}
+#endif
+
+void G_Ticker(void) {
+    PROF_BEGIN(ticker_start);
+#ifdef VITA_SAVE
+    run_save_request();
+#endif
+#ifdef VITA_BENCH
+    run_bench_demo_end();
+#endif
+    G_Ticker_Upstream();
+    PROF_END(PROF_TICKER, ticker_start);
+}
+
+#ifdef VITA_ANALOG
+static int clamp_move(int value) {
+    return value > MAXPLMOVE ? MAXPLMOVE : value < -MAXPLMOVE ? -MAXPLMOVE : value;
+}
+#endif
+
+void G_BuildTiccmd(ticcmd_t *cmd, int maketic) {
+    G_BuildTiccmd_Upstream(cmd, maketic);
+
+#ifdef VITA_ANALOG
+    float move_x, move_y, turn;
+
+    // Nel menu le levette non devono muovere il giocatore
+    if (gamestate != GS_LEVEL || menuactive || paused || demoplayback)
+        return;
+
+    // Corsa piena = velocita' di corsa; la rotazione e' quella veloce
+    vita_input_analog(&move_x, &move_y, &turn);
+    cmd->forwardmove = clamp_move(cmd->forwardmove + (int)(move_y * forwardmove[1]));
+    cmd->sidemove = clamp_move(cmd->sidemove + (int)(move_x * sidemove[1]));
+    cmd->angleturn -= (short)(turn * angleturn[1]);
+#endif
+}
@@ -0,0 +1,34 @@
+// i_input.c di doomgeneric con I_GetEvent che svuota la coda del pad a
+// lotti (DG_GetKeys) invece di chiamare DG_GetKey per ogni evento. La
+// traduzione dei tasti resta quella di upstream.
+
+#define I_GetEvent I_GetEvent_Upstream
+#include "i_input.c"
+#undef I_GetEvent
+
+#include "vita_input.h"
+
+void I_GetEvent(void);
+
+void I_GetEvent(void) {
+    input_event_t events[INPUT_EVENT_BATCH];
+    int count = DG_GetKeys(events, INPUT_EVENT_BATCH);
+
+    for (int i = 0; i < count; i++) {
+        unsigned char key = INPUT_EVENT_KEY(events[i]);
+        int pressed = INPUT_EVENT_PRESSED(events[i]);
+        event_t event;
+
+        UpdateShiftStatus(pressed, key);
+
+        // data2 e' il carattere digitato solo per ev_keydown
+        memset(&event, 0, sizeof(event));
+        event.type = pressed ? ev_keydown : ev_keyup;
+        event.data1 = TranslateKey(key);
+        if (pressed)
+            event.data2 = GetTypedChar(key);
+
+        if (event.data1 != 0)
+            D_PostEvent(&event);
+    }
+}
@@ -0,0 +1,13 @@
+// p_setup.c di doomgeneric con P_SetupLevel intercettata per misurare il
+// tempo di caricamento dei livelli (vita_prefetch.c).
+
+#define P_SetupLevel P_SetupLevel_Upstream
+#include "p_setup.c"
+#undef P_SetupLevel
+
+#include "vita_prefetch.h"
+
+void P_SetupLevel(int episode, int map, int playermask, skill_t skill) {
+    vita_prefetch_level_start(episode, map);
+    P_SetupLevel_Upstream(episode, map, playermask, skill);
+}
@@ -0,0 +1,467 @@
+// r_data.c di doomgeneric con due aggiunte per la Vita:
+//
+//  - l'accesso alle texture che serve al prefetch dei livelli
+//    (vita_prefetch.c): le composite vengono costruite qui invece che al
+//    primo R_GetColumn durante il rendering;
+//  - una cache su disco delle texture (VITA_TEXTURE_CACHE), letta con una
+//    sola lettura all'avvio: definizioni, tabelle delle colonne di
+//    R_GenerateLookup e composite. Con la cache valida R_InitTextures non
+//    legge TEXTURE1/2 e non rifa' il lookup; texturecolumnlump[],
+//    texturecolumnofs[] e texturecomposite[] puntano nell'immagine caricata.
+
+#define R_InitData R_InitData_Upstream
+#ifdef VITA_TEXTURE_CACHE
+#define R_InitTextures R_InitTextures_Upstream
+#endif
+#include "r_data.c"
+#ifdef VITA_TEXTURE_CACHE
+#undef R_InitTextures
+#endif
+#undef R_InitData
+
+#include <stdio.h>
+#include <string.h>
+
+#include "doomgeneric.h"
+#include "doomstat.h"
+#include "m_argv.h"
+#include "vita_prefetch.h"
+#include "vita_startup.h"
+
+void R_InitData(void);
+
+#ifdef VITA_PREFETCH
+void R_WarmTexture(int texnum) {
+    texture_t *texture;
+
+    if (texnum <= 0 || texnum >= numtextures)
+        return;
+
+    texture = textures[texnum];
+
+    for (int i = 0; i < texture->patchcount; i++)
+        W_CacheLumpNum(texture->patches[i].patch, PU_CACHE);
+
+    // Solo le texture con colonne a piu' patch hanno una composita
+    if (texturecompositesize[texnum] > 0 && !texturecomposite[texnum])
+        R_GenerateComposite(texnum);
+}
+#endif
+
+#ifdef VITA_TEXTURE_CACHE
+
+#include <psp2/io/fcntl.h>
+#include <psp2/io/stat.h>
+
+#define TEXCACHE_DIR "ux0:data/ChexQuest/cache"
+#define TEXCACHE_PATH TEXCACHE_DIR "/textures.bin"
+#define TEXCACHE_TMP_PATH TEXCACHE_DIR "/textures.tmp"
+#define TEXCACHE_MAGIC "CQTEXC02"
+
+// Buffer di scrittura: la memory card non ama le scritture piccole
+#define TEXCACHE_WRITE_BUFFER (64 * 1024)
+
+// Date di modifica dei WAD, da engine/w_file_vita.c
+extern SceDateTime vita_wad_mtimes[];
+extern int vita_num_wad_mtimes;
+
+// Intestazione del file. Seguono struct TexCacheTexture[numtextures],
+// texpatch_t[numpatches], texturecolumnlump e texturecolumnofs di tutte le
+// texture in fila (totalwidth colonne) e i dati delle composite. Ogni blocco
+// resta allineato al tipo che contiene.
+struct TexCacheHeader {
+    char magic[8];
+    uint64_t key;                   // texture_cache_key
+    int32_t numtextures;
+    int32_t numpatches;
+    int32_t totalwidth;
+    uint32_t data_size;
+};
+
+struct TexCacheTexture {
+    char name[8];
+    int16_t width;
+    int16_t height;
+    int16_t patchcount;
+    int16_t unused;
+    int32_t compositesize;          // 0 senza composita
+    uint32_t offset;                // della composita nei dati
+};
+
+struct TexCacheWriter {
+    SceUID fd;
+    int used;
+    int failed;
+    uint64_t key;
+    int next;                       // prossima composita da scrivere
+    byte buffer[TEXCACHE_WRITE_BUFFER];
+};
+
+static struct TexCacheWriter writer = { .fd = -1 };
+
+void R_InitTextures(void);
+
+static uint64_t fnv1a(uint64_t hash, const void *data, size_t len) {
+    const byte *p = data;
+
+    while (len--) {
+        hash ^= *p++;
+        hash *= 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+static uint64_t hash_lump_name(uint64_t hash, char *name) {
+    int lump = W_CheckNumForName(name);
+
+    if (lump < 0)
+        return hash;
+
+    hash = fnv1a(hash, W_CacheLumpNum(lump, PU_STATIC), W_LumpLength(lump));
+    W_ReleaseLumpNum(lump);
+    return hash;
+}
+
+// Si calcola prima di leggere le texture, quindi solo con quello che c'e'
+// gia': la directory (nomi, posizioni e dimensioni dei lump), PNAMES e
+// TEXTURE1/2, dimensione e data di modifica di ogni WAD. Le patch non si
+// leggono: un WAD riscritto cambia comunque data di modifica
+static uint64_t texture_cache_key(void) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    wad_file_t *wad = NULL;
+
+    for (unsigned int i = 0; i < numlumps; i++) {
+        hash = fnv1a(hash, lumpinfo[i].name, 8);
+        hash = fnv1a(hash, &lumpinfo[i].position, sizeof(lumpinfo[i].position));
+        hash = fnv1a(hash, &lumpinfo[i].size, sizeof(lumpinfo[i].size));
+
+        if (lumpinfo[i].wad_file != wad) {
+            wad = lumpinfo[i].wad_file;
+            hash = fnv1a(hash, &wad->length, sizeof(wad->length));
+        }
+    }
+
+    hash = fnv1a(hash, vita_wad_mtimes, vita_num_wad_mtimes * sizeof(vita_wad_mtimes[0]));
+
+    hash = hash_lump_name(hash, DEH_String("PNAMES"));
+    hash = hash_lump_name(hash, DEH_String("TEXTURE1"));
+    return hash_lump_name(hash, DEH_String("TEXTURE2"));
+}
+
+static boolean read_fully(SceUID fd, byte *dest, unsigned int length) {
+    unsigned int done = 0;
+
+    while (done < length) {
+        int got = sceIoRead(fd, dest + done, length - done);
+        if (got <= 0)
+            return false;
+        done += got;
+    }
+
+    return true;
+}
+
+// Controlla tutta l'immagine prima di toccare le variabili del motore: con
+// un file non valido si torna a R_InitTextures di upstream
+static boolean valid_texture_cache(const byte *image, SceOff size, uint64_t key) {
+    const struct TexCacheHeader *header = (const struct TexCacheHeader *)image;
+    const struct TexCacheTexture *tex;
+    const texpatch_t *patches;
+    int64_t expected;
+    int numpatches = 0, totalwidth = 0;
+
+    if (size < (SceOff)sizeof(*header) || memcmp(header->magic, TEXCACHE_MAGIC, 8) != 0 ||
+        header->key != key || header->numtextures <= 0 || header->numpatches < 0 ||
+        header->totalwidth < 0)
+        return false;
+
+    expected = sizeof(*header) +
+               (int64_t)header->numtextures * sizeof(struct TexCacheTexture) +
+               (int64_t)header->numpatches * sizeof(texpatch_t) +
+               (int64_t)header->totalwidth * (sizeof(short) + sizeof(unsigned short)) +
+               header->data_size;
+    if (size != expected)
+        return false;
+
+    tex = (const struct TexCacheTexture *)(header + 1);
+    patches = (const texpatch_t *)(tex + header->numtextures);
+
+    for (int i = 0; i < header->numtextures; i++) {
+        if (tex[i].width <= 0 || tex[i].patchcount < 0 || tex[i].compositesize < 0 ||
+            (uint64_t)tex[i].offset + tex[i].compositesize > header->data_size)
+            return false;
+        numpatches += tex[i].patchcount;
+        totalwidth += tex[i].width;
+    }
+
+    if (numpatches != header->numpatches || totalwidth != header->totalwidth)
+        return false;
+
+    for (int i = 0; i < numpatches; i++)
+        if (patches[i].patch < 0 || patches[i].patch >= (int)numlumps)
+            return false;
+
+    return true;
+}
+
+// Le stesse variabili di R_InitTextures di upstream, dalla cache invece che
+// da TEXTURE1/2 e R_GenerateLookup
+static void apply_texture_cache(byte *image) {
+    const struct TexCacheHeader *header = (const struct TexCacheHeader *)image;
+    const struct TexCacheTexture *tex = (const struct TexCacheTexture *)(header + 1);
+    const texpatch_t *patches;
+    short *collump;
+    unsigned short *colofs;
+    byte *data;
+
+    numtextures = header->numtextures;
+    patches = (const texpatch_t *)(tex + numtextures);
+    collump = (short *)(patches + header->numpatches);
+    colofs = (unsigned short *)(collump + header->totalwidth);
+    data = (byte *)(colofs + header->totalwidth);
+
+    textures = Z_Malloc(numtextures * sizeof(*textures), PU_STATIC, 0);
+    texturecolumnlump = Z_Malloc(numtextures * sizeof(*texturecolumnlump), PU_STATIC, 0);
+    texturecolumnofs = Z_Malloc(numtextures * sizeof(*texturecolumnofs), PU_STATIC, 0);
+    texturecomposite = Z_Malloc(numtextures * sizeof(*texturecomposite), PU_STATIC, 0);
+    texturecompositesize = Z_Malloc(numtextures * sizeof(*texturecompositesize), PU_STATIC, 0);
+    texturewidthmask = Z_Malloc(numtextures * sizeof(*texturewidthmask), PU_STATIC, 0);
+    textureheight = Z_Malloc(numtextures * sizeof(*textureheight), PU_STATIC, 0);
+
+    for (int i = 0; i < numtextures; i++, tex++) {
+        texture_t *texture;
+        int j = 1;
+
+        texture = textures[i] = Z_Malloc(sizeof(texture_t) +
+                                         sizeof(texpatch_t) * (tex->patchcount - 1),
+                                         PU_STATIC, 0);
+        memcpy(texture->name, tex->name, sizeof(texture->name));
+        texture->width = tex->width;
+        texture->height = tex->height;
+        texture->patchcount = tex->patchcount;
+        memcpy(texture->patches, patches, tex->patchcount * sizeof(texpatch_t));
+        patches += tex->patchcount;
+
+        texturecolumnlump[i] = collump;
+        texturecolumnofs[i] = colofs;
+        collump += tex->width;
+        colofs += tex->width;
+
+        texturecompositesize[i] = tex->compositesize;
+        texturecomposite[i] = tex->compositesize > 0 ? data + tex->offset : NULL;
+
+        while (j * 2 <= texture->width)
+            j <<= 1;
+        texturewidthmask[i] = j - 1;
+        textureheight[i] = texture->height << FRACBITS;
+    }
+
+    texturetranslation = Z_Malloc((numtextures + 1) * sizeof(*texturetranslation), PU_STATIC, 0);
+    for (int i = 0; i < numtextures; i++)
+        texturetranslation[i] = i;
+
+    GenerateTextureHashTable();
+}
+
+static boolean load_texture_cache(uint64_t key) {
+    byte *image;
+
+    SceUID fd = sceIoOpen(TEXCACHE_PATH, SCE_O_RDONLY, 0);
+    if (fd < 0)
+        return false;
+
+    SceOff size = sceIoLseek(fd, 0, SCE_SEEK_END);
+    if (size < (SceOff)sizeof(struct TexCacheHeader) || size > 0x7fffffff ||
+        sceIoLseek(fd, 0, SCE_SEEK_SET) != 0) {
+        sceIoClose(fd);
+        return false;
+    }
+
+    image = Z_Malloc(size, PU_STATIC, NULL);
+    if (!read_fully(fd, image, size) || !valid_texture_cache(image, size, key)) {
+        sceIoClose(fd);
+        Z_Free(image);
+        return false;
+    }
+    sceIoClose(fd);
+
+    apply_texture_cache(image);
+    return true;
+}
+
+static void cache_write(struct TexCacheWriter *w, const void *data, unsigned int len) {
+    const byte *p = data;
+
+    while (len > 0 && !w->failed) {
+        unsigned int chunk = TEXCACHE_WRITE_BUFFER - w->used;
+        if (chunk > len)
+            chunk = len;
+
+        memcpy(w->buffer + w->used, p, chunk);
+        w->used += chunk;
+        p += chunk;
+        len -= chunk;
+
+        if (w->used == TEXCACHE_WRITE_BUFFER) {
+            if (sceIoWrite(w->fd, w->buffer, w->used) != w->used)
+                w->failed = 1;
+            w->used = 0;
+        }
+    }
+}
+
+static void cache_flush(struct TexCacheWriter *w) {
+    if (w->used > 0 && !w->failed && sceIoWrite(w->fd, w->buffer, w->used) != w->used)
+        w->failed = 1;
+    w->used = 0;
+}
+
+// Apre il file temporaneo e scrive tutto tranne le composite: una cache a
+// meta' non deve mai sostituire quella buona
+static boolean begin_texture_cache(uint64_t key) {
+    struct TexCacheHeader header;
+    uint32_t offset = 0;
+    int numpatches = 0, totalwidth = 0;
+
+    sceIoMkdir(TEXCACHE_DIR, 0777);
+
+    writer.fd = sceIoOpen(TEXCACHE_TMP_PATH, SCE_O_WRONLY | SCE_O_CREAT | SCE_O_TRUNC, 0777);
+    if (writer.fd < 0)
+        return false;
+    writer.used = 0;
+    writer.failed = 0;
+    writer.key = key;
+    writer.next = 0;
+
+    for (int i = 0; i < numtextures; i++) {
+        numpatches += textures[i]->patchcount;
+        totalwidth += textures[i]->width;
+        if (texturecompositesize[i] > 0)
+            offset += texturecompositesize[i];
+    }
+
+    memcpy(header.magic, TEXCACHE_MAGIC, 8);
+    header.key = key;
+    header.numtextures = numtextures;
+    header.numpatches = numpatches;
+    header.totalwidth = totalwidth;
+    header.data_size = offset;
+    cache_write(&writer, &header, sizeof(header));
+
+    offset = 0;
+    for (int i = 0; i < numtextures; i++) {
+        struct TexCacheTexture tex = {0};
+
+        memcpy(tex.name, textures[i]->name, sizeof(tex.name));
+        tex.width = textures[i]->width;
+        tex.height = textures[i]->height;
+        tex.patchcount = textures[i]->patchcount;
+        if (texturecompositesize[i] > 0) {
+            tex.compositesize = texturecompositesize[i];
+            tex.offset = offset;
+            offset += texturecompositesize[i];
+        }
+        cache_write(&writer, &tex, sizeof(tex));
+    }
+
+    for (int i = 0; i < numtextures; i++)
+        cache_write(&writer, textures[i]->patches, textures[i]->patchcount * sizeof(texpatch_t));
+    for (int i = 0; i < numtextures; i++)
+        cache_write(&writer, texturecolumnlump[i], textures[i]->width * sizeof(short));
+    for (int i = 0; i < numtextures; i++)
+        cache_write(&writer, texturecolumnofs[i], textures[i]->width * sizeof(unsigned short));
+
+    return true;
+}
+
+// Scrive le composite da writer.next per al piu' budget_ms (0 = tutte);
+// true alla fine. Ognuna si costruisce, se manca, subito prima di copiarla:
+// sono blocchi PU_CACHE e una costruita prima potrebbe essere gia' eliminata
+static boolean write_composites(uint32_t budget_ms) {
+    uint32_t start = DG_GetTicksMs();
+
+    while (writer.next < numtextures) {
+        int i = writer.next++;
+
+        if (texturecompositesize[i] > 0) {
+            if (!texturecomposite[i])
+                R_GenerateComposite(i);
+            cache_write(&writer, texturecomposite[i], texturecompositesize[i]);
+        }
+
+        if (budget_ms > 0 && DG_GetTicksMs() - start >= budget_ms)
+            return writer.next >= numtextures;
+    }
+
+    return true;
+}
+
+static void finish_texture_cache(void) {
+    cache_flush(&writer);
+    sceIoClose(writer.fd);
+    writer.fd = -1;
+
+    if (writer.failed) {
+        sceIoRemove(TEXCACHE_TMP_PATH);
+        return;
+    }
+
+    sceIoRemove(TEXCACHE_PATH);
+    sceIoRename(TEXCACHE_TMP_PATH, TEXCACHE_PATH);
+}
+
+#ifdef VITA_STARTUP
+// Senza cache le composite si scrivono dopo, sullo schermo del titolo, poche
+// per giro del loop: l'avvio resta quello di upstream
+#define TEXCACHE_BUDGET_MS 4
+
+void R_TextureCacheTick(void) {
+    if (writer.fd < 0 || gamestate != GS_DEMOSCREEN)
+        return;
+
+    if (write_composites(TEXCACHE_BUDGET_MS))
+        finish_texture_cache();
+}
+#endif
+
+void R_InitTextures(void) {
+    uint64_t key;
+
+    if (M_CheckParm("-notexcache")) {
+        R_InitTextures_Upstream();
+        return;
+    }
+
+    key = texture_cache_key();
+    if (load_texture_cache(key))
+        return;
+
+    R_InitTextures_Upstream();
+
+    if (!begin_texture_cache(key))
+        return;
+
+#ifndef VITA_STARTUP
+    printf("\nR_InitData: building texture cache");
+    write_composites(0);
+    finish_texture_cache();
+#endif
+}
+
+#endif // VITA_TEXTURE_CACHE
+
+void R_InitData(void) {
+#ifdef VITA_TEXTURE_CACHE
+    // R_InitData di upstream, con la R_InitTextures di qui
+    R_InitTextures();
+    printf(".");
+    R_InitFlats();
+    printf(".");
+    R_InitSpriteLumps();
+    printf(".");
+    R_InitColormaps();
+#else
+    R_InitData_Upstream();
+#endif
+}
@@ -0,0 +1,285 @@
+// r_draw.c di doomgeneric con i drawer piu' usati sostituiti da versioni
+// srotolate per il Cortex-A9. Il resto del file (drawer a bassa
+// risoluzione, bordi, tabelle di traduzione) resta quello originale.
+//
+// Sulle colonne NEON non aiuta: ogni pixel e' un accesso indiretto
+// (sorgente -> colormap) e spostare gli indici dai registri NEON a quelli
+// ARM costa piu' del calcolo. Conviene srotolare e ridurre le scritture.
+//
+// Ogni drawer risolve lo stato dc_*/ds_* in una struct DrawCmd: con
+// VITA_RENDER_WORKERS il comando puo' essere accodato a un worker invece di
+// essere eseguito subito (vedi vita_rthreads.c).
+
+#define R_DrawColumn R_DrawColumn_Upstream
+#define R_DrawFuzzColumn R_DrawFuzzColumn_Upstream
+#define R_DrawTranslatedColumn R_DrawTranslatedColumn_Upstream
+#define R_DrawSpan R_DrawSpan_Upstream
+#include "r_draw.c"
+#undef R_DrawColumn
+#undef R_DrawFuzzColumn
+#undef R_DrawTranslatedColumn
+#undef R_DrawSpan
+
+#include "vita_rthreads.h"
+
+void R_DrawColumn(void);
+void R_DrawFuzzColumn(void);
+void R_DrawTranslatedColumn(void);
+void R_DrawSpan(void);
+
+// Un pixel di colonna: texel (altezza 128, con wrap) -> colormap
+#define COLUMN_PIXEL(ofs) \
+    dest[(ofs) * SCREENWIDTH] = colormap[source[(frac >> FRACBITS) & 127]]; \
+    frac += fracstep
+
+static void exec_column(const struct DrawCmd *cmd) {
+    byte *dest = cmd->dest;
+    int count = cmd->count;
+    fixed_t frac = cmd->frac;
+    fixed_t fracstep = cmd->step;
+    const byte *source = cmd->source;
+    const byte *colormap = cmd->colormap;
+
+    // 4 pixel per iterazione, poi la coda
+    while (count >= 4) {
+        COLUMN_PIXEL(0);
+        COLUMN_PIXEL(1);
+        COLUMN_PIXEL(2);
+        COLUMN_PIXEL(3);
+        dest += 4 * SCREENWIDTH;
+        count -= 4;
+    }
+
+    while (count-- > 0) {
+        COLUMN_PIXEL(0);
+        dest += SCREENWIDTH;
+    }
+}
+
+// Come COLUMN_PIXEL, con la tabella di traduzione dei colori (giocatori)
+// e senza wrap della sorgente, come nell'originale.
+#define TRANSLATED_PIXEL(ofs) \
+    dest[(ofs) * SCREENWIDTH] = colormap[translation[source[frac >> FRACBITS]]]; \
+    frac += fracstep
+
+static void exec_translated(const struct DrawCmd *cmd) {
+    byte *dest = cmd->dest;
+    int count = cmd->count;
+    fixed_t frac = cmd->frac;
+    fixed_t fracstep = cmd->step;
+    const byte *source = cmd->source;
+    const byte *translation = cmd->translation;
+    const byte *colormap = cmd->colormap;
+
+    while (count >= 4) {
+        TRANSLATED_PIXEL(0);
+        TRANSLATED_PIXEL(1);
+        TRANSLATED_PIXEL(2);
+        TRANSLATED_PIXEL(3);
+        dest += 4 * SCREENWIDTH;
+        count -= 4;
+    }
+
+    while (count-- > 0) {
+        TRANSLATED_PIXEL(0);
+        dest += SCREENWIDTH;
+    }
+}
+
+// Effetto "fuzz" (invisibilita'): scurisce il pixel sopra o sotto. Il
+// controllo di wrap dell'indice in fuzzoffset si fa una volta per tratto
+// invece che a ogni pixel.
+static void exec_fuzz(const struct DrawCmd *cmd) {
+    byte *dest = cmd->dest;
+    int count = cmd->count;
+    int pos = cmd->fuzzpos;
+    const byte *shade = cmd->colormap;
+
+    while (count > 0) {
+        int run = FUZZTABLE - pos;
+        const int *fuzz = fuzzoffset + pos;
+
+        if (run > count)
+            run = count;
+        count -= run;
+        pos = 0;
+
+        while (run-- > 0) {
+            *dest = shade[dest[*fuzz++]];
+            dest += SCREENWIDTH;
+        }
+    }
+}
+
+// Posizione nel flat 64x64 impacchettata come nell'originale:
+// 16 bit alti = x (6 bit usati), 16 bit bassi = y (6 bit usati).
+#define SPAN_TEXEL(pos) \
+    colormap[source[(((pos) >> 4) & 0x0fc0) | ((pos) >> 26)]]
+
+static void exec_span(const struct DrawCmd *cmd) {
+    byte *dest = cmd->dest;
+    int count = cmd->count;
+    unsigned int position = cmd->frac;
+    unsigned int step = cmd->step;
+    const byte *source = cmd->source;
+    const byte *colormap = cmd->colormap;
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // Fino all'allineamento a 4 byte, poi 4 pixel per scrittura a 32 bit
+    while (count > 0 && ((uintptr_t)dest & 3)) {
+        *dest++ = SPAN_TEXEL(position);
+        position += step;
+        count--;
+    }
+
+    while (count >= 4) {
+        uint32_t p0 = SPAN_TEXEL(position);
+        uint32_t p1 = SPAN_TEXEL(position + step);
+        uint32_t p2 = SPAN_TEXEL(position + 2 * step);
+        uint32_t p3 = SPAN_TEXEL(position + 3 * step);
+
+        *(uint32_t *)dest = p0 | (p1 << 8) | (p2 << 16) | (p3 << 24);
+        position += 4 * step;
+        dest += 4;
+        count -= 4;
+    }
+#endif
+
+    while (count-- > 0) {
+        *dest++ = SPAN_TEXEL(position);
+        position += step;
+    }
+}
+
+void R_ExecDrawCmd(const struct DrawCmd *cmd) {
+    switch (cmd->kind) {
+    case DRAWCMD_COLUMN:
+        exec_column(cmd);
+        break;
+    case DRAWCMD_TRANSLATED:
+        exec_translated(cmd);
+        break;
+    case DRAWCMD_FUZZ:
+        exec_fuzz(cmd);
+        break;
+    case DRAWCMD_SPAN:
+        exec_span(cmd);
+        break;
+    }
+}
+
+// Esegue subito o accoda al worker proprietario della colonna
+static void submit_column(const struct DrawCmd *cmd) {
+#ifdef VITA_RENDER_WORKERS
+    if (vita_rthreads_active) {
+        vita_rthreads_column(dc_x, cmd);
+        return;
+    }
+#endif
+    R_ExecDrawCmd(cmd);
+}
+
+void R_DrawColumn(void) {
+    struct DrawCmd cmd;
+    int count = dc_yh - dc_yl;
+
+    // Zero length, column does not exceed a pixel.
+    if (count < 0)
+        return;
+
+#ifdef RANGECHECK
+    if ((unsigned)dc_x >= SCREENWIDTH || dc_yl < 0 || dc_yh >= SCREENHEIGHT)
+        I_Error("R_DrawColumn: %i to %i at %i", dc_yl, dc_yh, dc_x);
+#endif
+
+    cmd.kind = DRAWCMD_COLUMN;
+    cmd.dest = ylookup[dc_yl] + columnofs[dc_x];
+    cmd.count = count + 1;
+    cmd.step = dc_iscale;
+    cmd.frac = dc_texturemid + (dc_yl - centery) * dc_iscale;
+    cmd.source = dc_source;
+    cmd.colormap = dc_colormap;
+    submit_column(&cmd);
+}
+
+void R_DrawTranslatedColumn(void) {
+    struct DrawCmd cmd;
+    int count = dc_yh - dc_yl;
+
+    if (count < 0)
+        return;
+
+#ifdef RANGECHECK
+    if ((unsigned)dc_x >= SCREENWIDTH || dc_yl < 0 || dc_yh >= SCREENHEIGHT)
+        I_Error("R_DrawTranslatedColumn: %i to %i at %i", dc_yl, dc_yh, dc_x);
+#endif
+
+    cmd.kind = DRAWCMD_TRANSLATED;
+    cmd.dest = ylookup[dc_yl] + columnofs[dc_x];
+    cmd.count = count + 1;
+    cmd.step = dc_iscale;
+    cmd.frac = dc_texturemid + (dc_yl - centery) * dc_iscale;
+    cmd.source = dc_source;
+    cmd.colormap = dc_colormap;
+    cmd.translation = dc_translation;
+    submit_column(&cmd);
+}
+
+void R_DrawFuzzColumn(void) {
+    struct DrawCmd cmd;
+    int count;
+
+    // Adjust borders. Low...
+    if (!dc_yl)
+        dc_yl = 1;
+
+    // .. and high.
+    if (dc_yh == viewheight - 1)
+        dc_yh = viewheight - 2;
+
+    count = dc_yh - dc_yl;
+    if (count < 0)
+        return;
+
+#ifdef RANGECHECK
+    if ((unsigned)dc_x >= SCREENWIDTH || dc_yl < 0 || dc_yh >= SCREENHEIGHT)
+        I_Error("R_DrawFuzzColumn: %i to %i at %i", dc_yl, dc_yh, dc_x);
+#endif
+
+    cmd.kind = DRAWCMD_FUZZ;
+    cmd.dest = ylookup[dc_yl] + columnofs[dc_x];
+    cmd.count = count + 1;
+    cmd.colormap = colormaps + 6 * 256;
+    cmd.fuzzpos = fuzzpos;
+
+    // fuzzpos avanza qui, nell'ordine delle chiamate, anche se il disegno
+    // avviene piu' tardi su un worker
+    fuzzpos = (fuzzpos + cmd.count) % FUZZTABLE;
+
+    submit_column(&cmd);
+}
+
+void R_DrawSpan(void) {
+    struct DrawCmd cmd;
+
+#ifdef RANGECHECK
+    if (ds_x2 < ds_x1 || ds_x1 < 0 || ds_x2 >= SCREENWIDTH || (unsigned)ds_y > SCREENHEIGHT)
+        I_Error("R_DrawSpan: %i to %i at %i", ds_x1, ds_x2, ds_y);
+#endif
+
+    cmd.kind = DRAWCMD_SPAN;
+    cmd.dest = ylookup[ds_y] + columnofs[ds_x1];
+    cmd.count = ds_x2 - ds_x1 + 1;
+    cmd.frac = ((ds_xfrac << 10) & 0xffff0000) | ((ds_yfrac >> 6) & 0x0000ffff);
+    cmd.step = ((ds_xstep << 10) & 0xffff0000) | ((ds_ystep >> 6) & 0x0000ffff);
+    cmd.source = ds_source;
+    cmd.colormap = ds_colormap;
+
+#ifdef VITA_RENDER_WORKERS
+    if (vita_rthreads_active) {
+        vita_rthreads_span(ds_x1, &cmd);
+        return;
+    }
+#endif
+    R_ExecDrawCmd(&cmd);
+}
@@ -0,0 +1,46 @@
+// r_main.c di doomgeneric con R_RenderPlayerView intercettata: ogni frame
+// (sia quelli di D_Display che quelli extra tra i tic) passa dal rendering
+// interpolato di vita_interp.c e/o dai worker di vita_rthreads.c, ed e'
+// misurata dal profilo dei frame (vita_prof.c).
+
+#define R_RenderPlayerView R_RenderPlayerView_Upstream
+#include "r_main.c"
+#undef R_RenderPlayerView
+
+#ifdef VITA_INTERPOLATION
+#include "vita_interp.h"
+#endif
+#ifdef VITA_RENDER_WORKERS
+#include "vita_rthreads.h"
+#endif
+#include "vita_prof.h"
+
+void R_RenderPlayerView(player_t *player) {
+    PROF_BEGIN(render_start);
+
+#ifdef VITA_INTERPOLATION
+    int interp = vita_interp_enabled;
+
+    if (interp)
+        vita_interp_begin(player);
+#endif
+
+#ifdef VITA_RENDER_WORKERS
+    // I drawer a bassa risoluzione non passano dalle code
+    int threaded = !detailshift && vita_rthreads_begin(viewwidth);
+#endif
+
+    R_RenderPlayerView_Upstream(player);
+
+#ifdef VITA_RENDER_WORKERS
+    if (threaded)
+        vita_rthreads_end();
+#endif
+
+#ifdef VITA_INTERPOLATION
+    if (interp)
+        vita_interp_end();
+#endif
+
+    PROF_END(PROF_RENDER, render_start);
+}
@@ -0,0 +1,144 @@
+// w_file.c di doomgeneric con un backend WAD residente: ogni WAD viene letto
+// una volta sola in un blocco contiguo di sceKernelAllocMemBlock e marcato
+// come "mapped", cosi' W_CacheLumpNum ritorna puntatori nell'immagine invece
+// di copiare il lump in un blocco della zona. Se il blocco non si puo'
+// allocare (o con -nowadmap) si torna al backend stdio originale.
+//
+// Con entrambi i backend l'apertura annota la data di modifica del WAD, che
+// entra nella chiave della cache delle texture (engine/r_data_vita.c).
+
+#define W_OpenFile W_OpenFile_Upstream
+#include "w_file.c"
+#undef W_OpenFile
+
+#include <psp2/io/fcntl.h>
+#include <psp2/io/stat.h>
+#include <psp2/kernel/sysmem.h>
+#include <string.h>
+
+#include "z_zone.h"
+
+// I blocchi utente in LPDDR vanno allocati a multipli di 4 KiB
+#define WAD_BLOCK_ALIGN (4 * 1024)
+
+// Letture grandi e allineate: la memory card rende meglio con pochi
+// accessi lunghi che con tanti fread da un lump
+#define WAD_READ_CHUNK (1024 * 1024)
+
+// WAD annotati al massimo: oltre si perde solo la data nella chiave
+#define WAD_MAX_MTIMES 16
+
+typedef struct {
+    wad_file_t wad;
+    SceUID block;
+} vita_wad_file_t;
+
+extern wad_file_class_t vita_wad_file;
+
+// Date di modifica nell'ordine di apertura dei WAD
+SceDateTime vita_wad_mtimes[WAD_MAX_MTIMES];
+int vita_num_wad_mtimes = 0;
+
+static void record_mtime(char *path) {
+    SceIoStat st;
+
+    if (vita_num_wad_mtimes < WAD_MAX_MTIMES && sceIoGetstat(path, &st) >= 0)
+        vita_wad_mtimes[vita_num_wad_mtimes++] = st.st_mtime;
+}
+
+static int read_whole_file(SceUID fd, byte *dest, unsigned int length) {
+    unsigned int done = 0;
+
+    while (done < length) {
+        unsigned int chunk = length - done;
+        if (chunk > WAD_READ_CHUNK)
+            chunk = WAD_READ_CHUNK;
+
+        int got = sceIoRead(fd, dest + done, chunk);
+        if (got <= 0)
+            return 0;
+
+        done += got;
+    }
+
+    return 1;
+}
+
+static wad_file_t *W_Vita_OpenFile(char *path) {
+    SceUID fd = sceIoOpen(path, SCE_O_RDONLY, 0);
+    if (fd < 0)
+        return NULL;
+
+    SceOff size = sceIoLseek(fd, 0, SCE_SEEK_END);
+    if (size <= 0 || size > 0x7fffffff || sceIoLseek(fd, 0, SCE_SEEK_SET) != 0) {
+        sceIoClose(fd);
+        return NULL;
+    }
+
+    unsigned int length = (unsigned int)size;
+    SceSize block_size = (length + WAD_BLOCK_ALIGN - 1) & ~(WAD_BLOCK_ALIGN - 1);
+
+    SceUID block = sceKernelAllocMemBlock("cq_wad", SCE_KERNEL_MEMBLOCK_TYPE_USER_RW,
+                                          block_size, NULL);
+    if (block < 0) {
+        sceIoClose(fd);
+        return NULL;
+    }
+
+    void *base = NULL;
+    sceKernelGetMemBlockBase(block, &base);
+
+    if (!read_whole_file(fd, base, length)) {
+        sceIoClose(fd);
+        sceKernelFreeMemBlock(block);
+        return NULL;
+    }
+    sceIoClose(fd);
+
+    vita_wad_file_t *result = Z_Malloc(sizeof(vita_wad_file_t), PU_STATIC, 0);
+    result->wad.file_class = &vita_wad_file;
+    result->wad.mapped = base;
+    result->wad.length = length;
+    result->block = block;
+
+    return &result->wad;
+}
+
+static void W_Vita_CloseFile(wad_file_t *wad) {
+    vita_wad_file_t *vita_wad = (vita_wad_file_t *)wad;
+
+    sceKernelFreeMemBlock(vita_wad->block);
+    Z_Free(vita_wad);
+}
+
+// Usata da w_wad.c per intestazione e directory: e' gia' tutto in memoria
+static size_t W_Vita_Read(wad_file_t *wad, unsigned int offset,
+                          void *buffer, size_t buffer_len) {
+    if (offset >= wad->length)
+        return 0;
+
+    if (buffer_len > wad->length - offset)
+        buffer_len = wad->length - offset;
+
+    memcpy(buffer, wad->mapped + offset, buffer_len);
+    return buffer_len;
+}
+
+wad_file_class_t vita_wad_file = {
+    W_Vita_OpenFile,
+    W_Vita_CloseFile,
+    W_Vita_Read,
+};
+
+wad_file_t *W_OpenFile(char *path) {
+    wad_file_t *result = NULL;
+
+    if (!M_CheckParm("-nowadmap"))
+        result = vita_wad_file.OpenFile(path);
+    if (result == NULL)
+        result = W_OpenFile_Upstream(path);
+
+    if (result != NULL)
+        record_mtime(path);
+    return result;
+}
@@ -0,0 +1,709 @@
+// Sostituisce z_zone.c di doomgeneric con la stessa interfaccia (z_zone.h).
+// Al posto dell'unica lista first-fit con rover:
+//
+//  - pool per classi di dimensione (fino a 512 byte) con free list O(1);
+//  - un'arena a blocchi per PU_LEVEL e una per PU_LEVSPEC, azzerate in O(1)
+//    da Z_FreeTags al cambio di livello;
+//  - per il resto uno heap con liste libere segregate per potenza di due e
+//    fusione dei vicini liberi.
+//
+// La memoria viene da un unico sceKernelAllocMemBlock, di VITA_ZONE_MB
+// megabyte o di quanti ne chiede -mb (come I_ZoneBase in i_system.c).
+//
+// Ogni blocco ha la sua intestazione e sta nella lista del suo tag, tranne i
+// blocchi d'arena senza proprietario: sono la gran parte (mobj, linee,
+// settori...) e spariscono con l'arena senza essere visitati. Un blocco
+// d'arena che cambia tag verso un tag non di livello "scappa": il suo
+// pezzo d'arena resta fuori servizio finche' il blocco non viene liberato.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <psp2/kernel/sysmem.h>
+
+#include "doomtype.h"
+#include "i_system.h"
+#include "m_argv.h"
+#include "z_zone.h"
+#ifdef VITA_RENDER_WORKERS
+#include "vita_rthreads.h"
+#endif
+
+#define ZONEID 0x1d4a11
+
+#ifndef VITA_ZONE_MB
+#define VITA_ZONE_MB 32
+#endif
+
+// I blocchi utente in LPDDR vanno allocati a multipli di 4 KiB
+#define ZONE_BLOCK_ALIGN (4 * 1024)
+
+#define ALIGN8(x) (((x) + 7) & ~7)
+
+enum BlockSource {
+    SOURCE_POOL,
+    SOURCE_ARENA,
+    SOURCE_HEAP,
+};
+
+struct arena_chunk_s;
+
+typedef struct memblock_s {
+    struct memblock_s *prev;        // lista del tag (se linked)
+    struct memblock_s *next;
+    void **user;
+    struct arena_chunk_s *chunk;    // pezzo d'arena di provenienza
+    int size;                       // byte richiesti
+    unsigned char tag;
+    unsigned char source;
+    unsigned char cls;              // classe di dimensione, CLASS_NONE se oltre
+    unsigned char linked;
+    int id;                         // ZONEID se in uso
+} memblock_t;
+
+#define BLOCK_HEADER ALIGN8((int)sizeof(memblock_t))
+
+#define BLOCK_FROM_PTR(ptr) ((memblock_t *)((byte *)(ptr) - BLOCK_HEADER))
+#define PTR_FROM_BLOCK(block) ((void *)((byte *)(block) + BLOCK_HEADER))
+
+// --- Classi di dimensione ---
+
+#define NUM_CLASSES 6
+#define CLASS_NONE 0xff
+
+static const int class_sizes[NUM_CLASSES] = { 16, 32, 64, 128, 256, 512 };
+
+// Le classi si ricavano da una tabella a passi di 16 byte
+static unsigned char class_of_16[512 / 16];
+
+static int size_class(int size) {
+    if (size <= 0)
+        return 0;
+    if (size > class_sizes[NUM_CLASSES - 1])
+        return CLASS_NONE;
+    return class_of_16[(size - 1) >> 4];
+}
+
+// --- Liste per tag ---
+
+// Sentinelle: prev e' il blocco meno recente, next il piu' recente
+static memblock_t tag_lists[PU_NUM_TAGS];
+
+static void link_block(memblock_t *block) {
+    memblock_t *head = &tag_lists[block->tag];
+
+    block->prev = head;
+    block->next = head->next;
+    head->next->prev = block;
+    head->next = block;
+    block->linked = 1;
+}
+
+static void unlink_block(memblock_t *block) {
+    block->prev->next = block->next;
+    block->next->prev = block->prev;
+    block->linked = 0;
+}
+
+// --- Heap: liste libere segregate con boundary tag ---
+
+typedef struct hchunk_s {
+    uint32_t size;                  // byte totali, bit 0 = libero
+    uint32_t prev_size;             // del vicino precedente, 0 se e' il primo
+    struct hchunk_s *next_free;     // solo per i chunk liberi
+    struct hchunk_s *prev_free;
+} hchunk_t;
+
+#define HCHUNK_HEADER 8
+#define HCHUNK_FREE 1u
+#define HCHUNK_MIN ALIGN8((int)sizeof(hchunk_t) > 32 ? (int)sizeof(hchunk_t) : 32)
+
+// Chunk visitati nel bin di partenza prima di passare a quelli superiori
+#define HEAP_BIN_PROBES 8
+
+#define NUM_BINS 32
+
+static byte *heap_base;
+static byte *heap_end;
+static unsigned int heap_size;
+static unsigned int heap_free_bytes;
+
+static hchunk_t *bins[NUM_BINS];
+static uint32_t bin_bitmap;
+
+static unsigned int chunk_size(const hchunk_t *c) {
+    return c->size & ~7u;
+}
+
+static int chunk_is_free(const hchunk_t *c) {
+    return c->size & HCHUNK_FREE;
+}
+
+static hchunk_t *chunk_next(hchunk_t *c) {
+    byte *next = (byte *)c + chunk_size(c);
+    return next < heap_end ? (hchunk_t *)next : NULL;
+}
+
+static int bin_of(unsigned int size) {
+    return 31 - __builtin_clz(size);
+}
+
+static void bin_insert(hchunk_t *c) {
+    int b = bin_of(chunk_size(c));
+
+    c->size |= HCHUNK_FREE;
+    c->prev_free = NULL;
+    c->next_free = bins[b];
+    if (bins[b])
+        bins[b]->prev_free = c;
+    bins[b] = c;
+    bin_bitmap |= 1u << b;
+    heap_free_bytes += chunk_size(c);
+}
+
+static void bin_remove(hchunk_t *c) {
+    int b = bin_of(chunk_size(c));
+
+    if (c->prev_free)
+        c->prev_free->next_free = c->next_free;
+    else
+        bins[b] = c->next_free;
+    if (c->next_free)
+        c->next_free->prev_free = c->prev_free;
+    if (!bins[b])
+        bin_bitmap &= ~(1u << b);
+
+    c->size &= ~HCHUNK_FREE;
+    heap_free_bytes -= chunk_size(c);
+}
+
+static void *heap_alloc(unsigned int bytes) {
+    unsigned int size = ALIGN8(bytes + HCHUNK_HEADER);
+    hchunk_t *c;
+    int b;
+
+    if (size < (unsigned int)HCHUNK_MIN)
+        size = HCHUNK_MIN;
+
+    // Nel bin di partenza ci sono anche chunk piu' piccoli della richiesta
+    b = bin_of(size);
+    c = bins[b];
+    for (int probes = 0; c && probes < HEAP_BIN_PROBES; probes++, c = c->next_free)
+        if (chunk_size(c) >= size)
+            break;
+
+    // Nei bin superiori qualunque chunk va bene
+    if (!c || chunk_size(c) < size) {
+        uint32_t mask = bin_bitmap & ~((2u << b) - 1);
+        if (!mask)
+            return NULL;
+        c = bins[__builtin_ctz(mask)];
+    }
+
+    bin_remove(c);
+
+    unsigned int rest = chunk_size(c) - size;
+    if (rest >= (unsigned int)HCHUNK_MIN) {
+        hchunk_t *r = (hchunk_t *)((byte *)c + size);
+        hchunk_t *next;
+
+        r->size = rest;
+        r->prev_size = size;
+        next = chunk_next(r);
+        if (next)
+            next->prev_size = rest;
+
+        c->size = size;
+        bin_insert(r);
+    }
+
+    return (byte *)c + HCHUNK_HEADER;
+}
+
+static void heap_release(void *ptr) {
+    hchunk_t *c = (hchunk_t *)((byte *)ptr - HCHUNK_HEADER);
+    unsigned int size = chunk_size(c);
+    hchunk_t *next = chunk_next(c);
+
+    if (next && chunk_is_free(next)) {
+        bin_remove(next);
+        size += chunk_size(next);
+    }
+
+    if (c->prev_size) {
+        hchunk_t *prev = (hchunk_t *)((byte *)c - c->prev_size);
+        if (chunk_is_free(prev)) {
+            bin_remove(prev);
+            size += chunk_size(prev);
+            c = prev;
+        }
+    }
+
+    c->size = size;
+    next = chunk_next(c);
+    if (next)
+        next->prev_size = size;
+
+    bin_insert(c);
+}
+
+// --- Pool per classi ---
+
+#define POOL_SLAB_SIZE (16 * 1024)
+
+static memblock_t *pool_free[NUM_CLASSES];
+
+static void *heap_alloc_purge(unsigned int bytes);
+
+static memblock_t *pool_alloc(int cls) {
+    memblock_t *block = pool_free[cls];
+
+    if (!block) {
+        int unit = BLOCK_HEADER + class_sizes[cls];
+        byte *slab = heap_alloc_purge(POOL_SLAB_SIZE);
+
+        if (!slab)
+            return NULL;
+
+        for (int ofs = POOL_SLAB_SIZE - unit; ofs >= 0; ofs -= unit) {
+            memblock_t *b = (memblock_t *)(slab + ofs);
+            b->id = 0;
+            b->source = SOURCE_POOL;
+            b->cls = cls;
+            b->chunk = NULL;
+            b->next = pool_free[cls];
+            pool_free[cls] = b;
+        }
+
+        block = pool_free[cls];
+    }
+
+    pool_free[cls] = block->next;
+    return block;
+}
+
+// --- Arene di livello ---
+
+#define ARENA_CHUNK_SIZE (256 * 1024)
+
+// Oltre questa dimensione un blocco di livello va nello heap
+#define ARENA_MAX_ALLOC (ARENA_CHUNK_SIZE / 4)
+
+typedef struct arena_chunk_s {
+    struct arena_chunk_s *next;
+    struct arena_s *arena;
+    int used;                       // byte gia' assegnati dopo l'intestazione
+    int escaped;                    // blocchi vivi con un tag non di livello
+    int retired;                    // staccato dall'arena: escaped = blocchi vivi
+} arena_chunk_t;
+
+#define ARENA_CHUNK_HEADER ALIGN8((int)sizeof(arena_chunk_t))
+
+typedef struct arena_s {
+    int tag;
+    arena_chunk_t *chunks;          // il primo e' quello in riempimento
+    arena_chunk_t *retired;         // staccati al reset, con blocchi scappati
+    memblock_t *free[NUM_CLASSES];  // blocchi liberati, riusabili nel livello
+} arena_t;
+
+static arena_t arenas[] = {
+    { .tag = PU_LEVEL },
+    { .tag = PU_LEVSPEC },
+};
+
+static arena_t *arena_for_tag(int tag) {
+    for (unsigned int i = 0; i < arrlen(arenas); i++)
+        if (arenas[i].tag == tag)
+            return &arenas[i];
+    return NULL;
+}
+
+static memblock_t *arena_alloc(arena_t *a, int size, int cls) {
+    int unit;
+
+    if (cls != CLASS_NONE && a->free[cls]) {
+        memblock_t *block = a->free[cls];
+        a->free[cls] = block->next;
+        return block;
+    }
+
+    unit = BLOCK_HEADER + (cls != CLASS_NONE ? class_sizes[cls] : ALIGN8(size));
+
+    if (!a->chunks || a->chunks->used + unit > ARENA_CHUNK_SIZE - ARENA_CHUNK_HEADER) {
+        arena_chunk_t *chunk = heap_alloc_purge(ARENA_CHUNK_SIZE);
+
+        if (!chunk)
+            return NULL;
+
+        chunk->arena = a;
+        chunk->used = 0;
+        chunk->escaped = 0;
+        chunk->retired = 0;
+        chunk->next = a->chunks;
+        a->chunks = chunk;
+    }
+
+    memblock_t *block = (memblock_t *)((byte *)a->chunks + ARENA_CHUNK_HEADER + a->chunks->used);
+    a->chunks->used += unit;
+
+    block->source = SOURCE_ARENA;
+    block->cls = cls;
+    block->chunk = a->chunks;
+    return block;
+}
+
+static void retired_release(arena_t *a, arena_chunk_t *chunk) {
+    arena_chunk_t **p = &a->retired;
+
+    while (*p && *p != chunk)
+        p = &(*p)->next;
+
+    if (*p) {
+        *p = chunk->next;
+        heap_release(chunk);
+    }
+}
+
+static void arena_free_block(memblock_t *block) {
+    arena_chunk_t *chunk = block->chunk;
+    arena_t *a = chunk->arena;
+
+    // Un pezzo fuori servizio torna allo heap con l'ultimo blocco vivo
+    if (chunk->retired) {
+        if (--chunk->escaped == 0)
+            retired_release(a, chunk);
+        return;
+    }
+
+    if (block->tag != a->tag)
+        chunk->escaped--;
+
+    if (block->cls != CLASS_NONE) {
+        block->next = a->free[block->cls];
+        a->free[block->cls] = block;
+    }
+}
+
+static void free_block(memblock_t *block);
+
+static void arena_reset(arena_t *a) {
+    memblock_t *head = &tag_lists[a->tag];
+    arena_chunk_t *chunk, *next;
+    arena_chunk_t *keep = NULL;
+
+    // Solo i blocchi con proprietario (o venuti da pool e heap) sono in lista
+    while (head->next != head)
+        free_block(head->next);
+
+    for (chunk = a->chunks; chunk; chunk = next) {
+        next = chunk->next;
+
+        if (chunk->escaped > 0) {
+            chunk->retired = 1;
+            chunk->next = a->retired;
+            a->retired = chunk;
+        } else if (!keep) {
+            keep = chunk;
+            keep->used = 0;
+            keep->next = NULL;
+        } else {
+            heap_release(chunk);
+        }
+    }
+
+    a->chunks = keep;
+    memset(a->free, 0, sizeof(a->free));
+}
+
+// --- Svuotamento dei blocchi eliminabili ---
+
+static memblock_t *purge_candidate(void) {
+    for (int tag = PU_NUM_TAGS - 1; tag >= PU_PURGELEVEL; tag--) {
+        memblock_t *head = &tag_lists[tag];
+        if (head->prev != head)
+            return head->prev;
+    }
+    return NULL;
+}
+
+static void *heap_alloc_purge(unsigned int bytes) {
+    void *p = heap_alloc(bytes);
+
+#ifdef VITA_RENDER_WORKERS
+    // A meta' frame i worker leggono ancora colonne di compositi PU_CACHE:
+    // prima di eliminarne uno devono aver finito i comandi in coda
+    if (!p && vita_rthreads_active)
+        vita_rthreads_flush();
+#endif
+
+    while (!p) {
+        memblock_t *victim = purge_candidate();
+        if (!victim)
+            return NULL;
+
+        free_block(victim);
+        p = heap_alloc(bytes);
+    }
+
+    return p;
+}
+
+// --- Interfaccia z_zone.h ---
+
+// I blocchi d'arena senza proprietario restano fuori dalle liste finche'
+// hanno il tag della loro arena e questa li puo' ancora azzerare
+static int block_needs_link(const memblock_t *block) {
+    return !(block->source == SOURCE_ARENA && block->user == NULL &&
+             !block->chunk->retired && block->tag == block->chunk->arena->tag);
+}
+
+static void free_block(memblock_t *block) {
+    if (block->user)
+        *block->user = NULL;
+
+    if (block->linked)
+        unlink_block(block);
+
+    block->id = 0;
+    block->user = NULL;
+
+    switch (block->source) {
+    case SOURCE_POOL:
+        block->next = pool_free[block->cls];
+        pool_free[block->cls] = block;
+        break;
+    case SOURCE_ARENA:
+        arena_free_block(block);
+        break;
+    case SOURCE_HEAP:
+        heap_release(block);
+        break;
+    }
+}
+
+void Z_Init(void) {
+    int mb = VITA_ZONE_MB;
+    int p = M_CheckParmWithArgs("-mb", 1);
+
+    if (p > 0)
+        mb = atoi(myargv[p + 1]);
+    if (mb < 4)
+        mb = 4;
+
+    heap_size = (unsigned int)mb * 1024 * 1024;
+    heap_size &= ~(ZONE_BLOCK_ALIGN - 1);
+
+    SceUID block = sceKernelAllocMemBlock("cq_zone", SCE_KERNEL_MEMBLOCK_TYPE_USER_RW,
+                                          heap_size, NULL);
+    if (block < 0)
+        I_Error("Z_Init: unable to allocate %i MiB for the zone", mb);
+
+    void *base = NULL;
+    sceKernelGetMemBlockBase(block, &base);
+    heap_base = base;
+    heap_end = heap_base + heap_size;
+
+    printf("zone memory: %p, %x allocated for zone\n", base, heap_size);
+
+    for (int i = 0; i < PU_NUM_TAGS; i++)
+        tag_lists[i].prev = tag_lists[i].next = &tag_lists[i];
+
+    for (int i = 0, cls = 0; i < (int)arrlen(class_of_16); i++) {
+        while ((i + 1) * 16 > class_sizes[cls])
+            cls++;
+        class_of_16[i] = cls;
+    }
+
+    hchunk_t *c = (hchunk_t *)heap_base;
+    c->size = heap_size;
+    c->prev_size = 0;
+    bin_insert(c);
+}
+
+void *Z_Malloc(int size, int tag, void *user) {
+    arena_t *a = arena_for_tag(tag);
+    int cls = size_class(size);
+    memblock_t *block = NULL;
+
+    if (tag < PU_STATIC || tag >= PU_NUM_TAGS || tag == PU_FREE)
+        I_Error("Z_Malloc: attempted to allocate a block with an invalid tag: %i", tag);
+
+    if (user == NULL && tag >= PU_PURGELEVEL)
+        I_Error("Z_Malloc: an owner is required for purgable blocks");
+
+    if (a && size <= ARENA_MAX_ALLOC)
+        block = arena_alloc(a, size, cls);
+
+    if (!block && cls != CLASS_NONE)
+        block = pool_alloc(cls);
+
+    if (!block) {
+        block = heap_alloc_purge(BLOCK_HEADER + size);
+        if (!block)
+            I_Error("Z_Malloc: failed on allocation of %i bytes", size);
+
+        block->source = SOURCE_HEAP;
+        block->cls = CLASS_NONE;
+        block->chunk = NULL;
+    }
+
+    block->id = ZONEID;
+    block->size = size;
+    block->tag = tag;
+    block->user = user;
+    block->linked = 0;
+
+    if (block_needs_link(block))
+        link_block(block);
+
+    if (user)
+        *(void **)user = PTR_FROM_BLOCK(block);
+
+    return PTR_FROM_BLOCK(block);
+}
+
+void Z_Free(void *ptr) {
+    memblock_t *block = BLOCK_FROM_PTR(ptr);
+
+    if (block->id != ZONEID)
+        I_Error("Z_Free: freed a pointer without ZONEID");
+
+    free_block(block);
+}
+
+void Z_FreeTags(int lowtag, int hightag) {
+    for (int tag = lowtag; tag <= hightag; tag++) {
+        if (tag < 0 || tag >= PU_NUM_TAGS)
+            continue;
+
+        arena_t *a = arena_for_tag(tag);
+        if (a) {
+            arena_reset(a);
+            continue;
+        }
+
+        memblock_t *head = &tag_lists[tag];
+        while (head->next != head)
+            free_block(head->next);
+    }
+}
+
+void Z_ChangeTag2(void *ptr, int tag, char *file, int line) {
+    memblock_t *block = BLOCK_FROM_PTR(ptr);
+
+    if (block->id != ZONEID)
+        I_Error("%s:%i: Z_ChangeTag: block without a ZONEID!", file, line);
+
+    if (tag >= PU_PURGELEVEL && block->user == NULL)
+        I_Error("%s:%i: Z_ChangeTag: an owner is required for purgable blocks", file, line);
+
+    if (block->linked)
+        unlink_block(block);
+
+    if (block->source == SOURCE_ARENA && !block->chunk->retired) {
+        int arena_tag = block->chunk->arena->tag;
+
+        if (block->tag == arena_tag && tag != arena_tag)
+            block->chunk->escaped++;
+        else if (block->tag != arena_tag && tag == arena_tag)
+            block->chunk->escaped--;
+    }
+
+    // Anche a tag invariato il blocco torna in testa: la lista dei blocchi
+    // eliminabili resta ordinata dal meno recente
+    block->tag = tag;
+    if (block_needs_link(block))
+        link_block(block);
+}
+
+void Z_ChangeUser(void *ptr, void **user) {
+    memblock_t *block = BLOCK_FROM_PTR(ptr);
+
+    if (block->id != ZONEID)
+        I_Error("Z_ChangeUser: Tried to change user for invalid block!");
+
+    block->user = user;
+    *user = ptr;
+
+    if (!block->linked && block_needs_link(block))
+        link_block(block);
+}
+
+void Z_CheckHeap(void) {
+    for (int tag = 0; tag < PU_NUM_TAGS; tag++) {
+        memblock_t *head = &tag_lists[tag];
+
+        for (memblock_t *b = head->next; b != head; b = b->next) {
+            if (b->id != ZONEID)
+                I_Error("Z_CheckHeap: block without a ZONEID in tag list %i", tag);
+            if (b->tag != tag)
+                I_Error("Z_CheckHeap: block with tag %i in list %i", b->tag, tag);
+            if (b->next->prev != b)
+                I_Error("Z_CheckHeap: broken tag list %i", tag);
+        }
+    }
+
+    unsigned int prev_size = 0;
+    for (hchunk_t *c = (hchunk_t *)heap_base; c; c = chunk_next(c)) {
+        if (chunk_size(c) < (unsigned int)HCHUNK_MIN || c->prev_size != prev_size)
+            I_Error("Z_CheckHeap: corrupt heap chunk at %p", (void *)c);
+        prev_size = chunk_size(c);
+    }
+}
+
+static void dump_tags(FILE *f, int lowtag, int hightag) {
+    fprintf(f, "zone size: %u  free: %u\n", heap_size, heap_free_bytes);
+
+    for (int tag = lowtag; tag <= hightag; tag++) {
+        memblock_t *head;
+        int count = 0, bytes = 0;
+
+        if (tag < 0 || tag >= PU_NUM_TAGS)
+            continue;
+
+        head = &tag_lists[tag];
+        for (memblock_t *b = head->next; b != head; b = b->next) {
+            count++;
+            bytes += b->size;
+        }
+
+        fprintf(f, "tag %i: %i blocks, %i bytes\n", tag, count, bytes);
+    }
+
+    for (unsigned int i = 0; i < arrlen(arenas); i++) {
+        int chunks = 0, retired = 0;
+
+        for (arena_chunk_t *c = arenas[i].chunks; c; c = c->next)
+            chunks++;
+        for (arena_chunk_t *c = arenas[i].retired; c; c = c->next)
+            retired++;
+
+        fprintf(f, "arena %i: %i chunks, %i retired\n", arenas[i].tag, chunks, retired);
+    }
+}
+
+void Z_DumpHeap(int lowtag, int hightag) {
+    dump_tags(stdout, lowtag, hightag);
+}
+
+void Z_FileDumpHeap(FILE *f) {
+    dump_tags(f, 0, PU_NUM_TAGS - 1);
+}
+
+int Z_FreeMemory(void) {
+    unsigned int free = heap_free_bytes;
+
+    for (int tag = PU_PURGELEVEL; tag < PU_NUM_TAGS; tag++) {
+        memblock_t *head = &tag_lists[tag];
+
+        for (memblock_t *b = head->next; b != head; b = b->next)
+            free += b->size;
+    }
+
+    return free;
+}
+
+unsigned int Z_ZoneSize(void) {
+    return heap_size;
+}
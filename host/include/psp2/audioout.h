@@ -0,0 +1,30 @@
+#ifndef HOST_PSP2_AUDIOOUT_H
+#define HOST_PSP2_AUDIOOUT_H
+
+// Uscita audio senza suono: sceAudioOutOutput scarta il blocco e blocca
+// per la sua durata, come il driver della Vita con il buffer pieno
+
+typedef enum SceAudioOutPortType {
+    SCE_AUDIO_OUT_PORT_TYPE_MAIN  = 0,
+    SCE_AUDIO_OUT_PORT_TYPE_BGM   = 1,
+    SCE_AUDIO_OUT_PORT_TYPE_VOICE = 2,
+} SceAudioOutPortType;
+
+typedef enum SceAudioOutMode {
+    SCE_AUDIO_OUT_MODE_MONO   = 0,
+    SCE_AUDIO_OUT_MODE_STEREO = 1,
+} SceAudioOutMode;
+
+#define SCE_AUDIO_VOLUME_0DB 32768
+
+enum {
+    SCE_AUDIO_VOLUME_FLAG_L_CH = 0x1,
+    SCE_AUDIO_VOLUME_FLAG_R_CH = 0x2,
+};
+
+int sceAudioOutOpenPort(SceAudioOutPortType type, int len, int freq, SceAudioOutMode mode);
+int sceAudioOutReleasePort(int port);
+int sceAudioOutOutput(int port, const void *buf);
+int sceAudioOutSetVolume(int port, int flag, int *vol);
+
+#endif
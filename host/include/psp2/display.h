@@ -0,0 +1,8 @@
+#ifndef HOST_PSP2_DISPLAY_H
+#define HOST_PSP2_DISPLAY_H
+
+// Display simulato a 59.94 Hz sull'orologio monotono
+int sceDisplayGetVcount(void);
+int sceDisplayWaitVblankStart(void);
+
+#endif
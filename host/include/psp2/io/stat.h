@@ -0,0 +1,24 @@
+#ifndef HOST_PSP2_IO_STAT_H
+#define HOST_PSP2_IO_STAT_H
+
+#include <psp2/types.h>
+
+// <sys/stat.h> di glibc definisce st_atime, st_mtime e st_ctime come macro
+#undef st_atime
+#undef st_mtime
+#undef st_ctime
+
+typedef struct SceIoStat {
+    SceMode st_mode;
+    unsigned int st_attr;
+    SceOff st_size;
+    SceDateTime st_ctime;
+    SceDateTime st_atime;
+    SceDateTime st_mtime;
+    unsigned int st_private[6];
+} SceIoStat;
+
+int sceIoMkdir(const char *dir, SceMode mode);
+int sceIoGetstat(const char *file, SceIoStat *stat);
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef HOST_PSP2_KERNEL_PROCESSMGR_H
+#define HOST_PSP2_KERNEL_PROCESSMGR_H
+
+#include <psp2/types.h>
+
+// Microsecondi dall'avvio del processo
+SceUInt64 sceKernelGetProcessTimeWide(void);
+SceUInt32 sceKernelGetProcessTimeLow(void);
+
+int sceKernelDelayThread(SceUInt delay);
+int sceKernelExitProcess(int res);
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef HOST_PSP2_KERNEL_SYSMEM_H
+#define HOST_PSP2_KERNEL_SYSMEM_H
+
+#include <psp2/types.h>
+
+#define SCE_KERNEL_MEMBLOCK_TYPE_USER_RW        0x0c20d060
+#define SCE_KERNEL_MEMBLOCK_TYPE_USER_CDRAM_RW  0x09408060
+
+// Blocchi allineati a 4 KiB; come sulla Vita la dimensione deve esserne
+// un multiplo
+SceUID sceKernelAllocMemBlock(const char *name, SceUInt32 type, SceSize size, void *opt);
+int sceKernelFreeMemBlock(SceUID uid);
+int sceKernelGetMemBlockBase(SceUID uid, void **base);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef HOST_PSP2_KERNEL_THREADMGR_H
+#define HOST_PSP2_KERNEL_THREADMGR_H
+
+#include <psp2/types.h>
+
+// Le maschere USER_0..2 diventano l'affinita' verso le CPU 0..2 del host
+#define SCE_KERNEL_CPU_MASK_USER_0  0x00010000
+#define SCE_KERNEL_CPU_MASK_USER_1  0x00020000
+#define SCE_KERNEL_CPU_MASK_USER_2  0x00040000
+#define SCE_KERNEL_CPU_MASK_USER_ALL \
+    (SCE_KERNEL_CPU_MASK_USER_0 | SCE_KERNEL_CPU_MASK_USER_1 | SCE_KERNEL_CPU_MASK_USER_2)
+
+#define SCE_KERNEL_ERROR_WAIT_TIMEOUT   0x80028005
+#define SCE_KERNEL_ERROR_SEMA_OVF       0x8002802A
+
+typedef int (*SceKernelThreadEntry)(SceSize args, void *argp);
+
+// Threads POSIX; priorita' e attributi sono ignorati
+SceUID sceKernelCreateThread(const char *name, SceKernelThreadEntry entry, int initPriority,
+                             SceSize stackSize, SceUInt attr, int cpuAffinityMask,
+                             const void *option);
+int sceKernelStartThread(SceUID thid, SceSize arglen, void *argp);
+int sceKernelWaitThreadEnd(SceUID thid, int *stat, SceUInt *timeout);
+int sceKernelGetThreadId(void);
+int sceKernelChangeThreadCpuAffinityMask(SceUID thid, int cpuAffinityMask);
+
+// Semafori contatori; timeout in microsecondi come sulla Vita
+SceUID sceKernelCreateSema(const char *name, SceUInt attr, int initVal, int maxVal, void *option);
+int sceKernelDeleteSema(SceUID semaid);
+int sceKernelWaitSema(SceUID semaid, int signal, SceUInt *timeout);
+int sceKernelSignalSema(SceUID semaid, int signal);
+
+int sceKernelDelayThread(SceUInt delay);
+
+#endif
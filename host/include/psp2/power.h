@@ -0,0 +1,11 @@
+#ifndef HOST_PSP2_POWER_H
+#define HOST_PSP2_POWER_H
+
+// Clock ricordati e basta: il host gira alla sua velocita'
+int scePowerSetArmClockFrequency(int freq);
+int scePowerSetBusClockFrequency(int freq);
+int scePowerSetGpuClockFrequency(int freq);
+int scePowerSetGpuXbarClockFrequency(int freq);
+int scePowerGetArmClockFrequency(void);
+
+#endif
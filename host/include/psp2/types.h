@@ -0,0 +1,28 @@
+#ifndef HOST_PSP2_TYPES_H
+#define HOST_PSP2_TYPES_H
+
+// Shim di VitaSDK per la build host (VITA_HOST_BUILD): solo i tipi e le
+// funzioni usati dal livello di piattaforma, con le stesse firme.
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int SceUID;
+typedef unsigned int SceSize;
+typedef int64_t SceOff;
+typedef int SceMode;
+typedef unsigned int SceUInt;
+typedef uint32_t SceUInt32;
+typedef uint64_t SceUInt64;
+
+typedef struct SceDateTime {
+    unsigned short year;
+    unsigned short month;
+    unsigned short day;
+    unsigned short hour;
+    unsigned short minute;
+    unsigned short second;
+    unsigned int microsecond;
+} SceDateTime;
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef HOST_VITA2D_H
+#define HOST_VITA2D_H
+
+// vita2d fuori schermo per la build host: le texture sono memoria normale
+// con lo stesso stride e formato di vita2d, il disegno non produce nulla e
+// lo swap aspetta il vblank simulato se richiesto.
+
+#include <psp2/types.h>
+
+#define RGBA8(r, g, b, a) ((((a) & 0xFF) << 24) | (((b) & 0xFF) << 16) | \
+                           (((g) & 0xFF) << 8) | (((r) & 0xFF) << 0))
+
+typedef enum SceGxmTextureFormat {
+    SCE_GXM_TEXTURE_FORMAT_A8B8G8R8,
+    SCE_GXM_TEXTURE_FORMAT_U8U8U8U8_ABGR = SCE_GXM_TEXTURE_FORMAT_A8B8G8R8,
+    SCE_GXM_TEXTURE_FORMAT_X8U8U8U8_1RGB,
+    SCE_GXM_TEXTURE_FORMAT_P8_ABGR,
+} SceGxmTextureFormat;
+
+typedef enum SceGxmTextureFilter {
+    SCE_GXM_TEXTURE_FILTER_POINT,
+    SCE_GXM_TEXTURE_FILTER_LINEAR,
+} SceGxmTextureFilter;
+
+#define SCE_GXM_SCENE_FRAGMENT_SET_DEPENDENCY   0x00000001
+#define SCE_GXM_SCENE_VERTEX_WAIT_FOR_DEPENDENCY 0x00000002
+
+typedef struct vita2d_texture vita2d_texture;
+typedef struct vita2d_pgf vita2d_pgf;
+
+int vita2d_init(void);
+int vita2d_fini(void);
+
+void vita2d_set_clear_color(unsigned int color);
+void vita2d_set_vblank_wait(int enable);
+void vita2d_clear_screen(void);
+void vita2d_start_drawing(void);
+void vita2d_start_drawing_advanced(vita2d_texture *target, unsigned int flags);
+void vita2d_end_drawing(void);
+void vita2d_swap_buffers(void);
+void vita2d_wait_rendering_done(void);
+
+vita2d_texture *vita2d_create_empty_texture(unsigned int w, unsigned int h);
+vita2d_texture *vita2d_create_empty_texture_format(unsigned int w, unsigned int h,
+                                                   SceGxmTextureFormat format);
+vita2d_texture *vita2d_create_empty_texture_rendertarget(unsigned int w, unsigned int h,
+                                                         SceGxmTextureFormat format);
+void vita2d_free_texture(vita2d_texture *texture);
+
+unsigned int vita2d_texture_get_width(const vita2d_texture *texture);
+unsigned int vita2d_texture_get_height(const vita2d_texture *texture);
+unsigned int vita2d_texture_get_stride(const vita2d_texture *texture);
+void *vita2d_texture_get_datap(const vita2d_texture *texture);
+void *vita2d_texture_get_palette(const vita2d_texture *texture);
+void vita2d_texture_set_filters(vita2d_texture *texture, SceGxmTextureFilter min_filter,
+                                SceGxmTextureFilter mag_filter);
+
+void vita2d_draw_texture(const vita2d_texture *texture, float x, float y);
+void vita2d_draw_texture_scale(const vita2d_texture *texture, float x, float y,
+                               float x_scale, float y_scale);
+void vita2d_draw_texture_part_scale(const vita2d_texture *texture, float x, float y,
+                                    float tex_x, float tex_y, float tex_w, float tex_h,
+                                    float x_scale, float y_scale);
+void vita2d_draw_rectangle(float x, float y, float w, float h, unsigned int color);
+
+vita2d_pgf *vita2d_load_default_pgf(void);
+void vita2d_free_pgf(vita2d_pgf *font);
+int vita2d_pgf_draw_text(vita2d_pgf *font, int x, int y, unsigned int color, float scale,
+                         const char *text);
+int vita2d_pgf_draw_textf(vita2d_pgf *font, int x, int y, unsigned int color, float scale,
+                          const char *text, ...);
+
+#endif
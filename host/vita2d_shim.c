@@ -0,0 +1,205 @@
+// vita2d fuori schermo per la build host (VITA_HOST_BUILD). Le texture
+// hanno lo stesso layout di quelle vere (larghezza allineata a 8, palette
+// a parte per P8), cosi' conversione e copia dei pixel fanno lo stesso
+// lavoro; i comandi di disegno non producono nulla.
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <psp2/display.h>
+#include <vita2d.h>
+
+struct vita2d_texture {
+    unsigned int width, height;
+    unsigned int stride;            // in byte
+    SceGxmTextureFormat format;
+    void *data;
+    uint32_t *palette;
+};
+
+struct vita2d_pgf {
+    int unused;
+};
+
+static int vblank_wait = 1;
+
+int vita2d_init(void) {
+    return 1;
+}
+
+int vita2d_fini(void) {
+    return 1;
+}
+
+void vita2d_set_clear_color(unsigned int color) {
+    (void)color;
+}
+
+void vita2d_set_vblank_wait(int enable) {
+    vblank_wait = enable;
+}
+
+void vita2d_clear_screen(void) {
+}
+
+void vita2d_start_drawing(void) {
+}
+
+void vita2d_start_drawing_advanced(vita2d_texture *target, unsigned int flags) {
+    (void)target;
+    (void)flags;
+}
+
+void vita2d_end_drawing(void) {
+}
+
+void vita2d_swap_buffers(void) {
+    if (vblank_wait)
+        sceDisplayWaitVblankStart();
+}
+
+void vita2d_wait_rendering_done(void) {
+}
+
+static unsigned int format_bpp(SceGxmTextureFormat format) {
+    return format == SCE_GXM_TEXTURE_FORMAT_P8_ABGR ? 1 : 4;
+}
+
+vita2d_texture *vita2d_create_empty_texture_format(unsigned int w, unsigned int h,
+                                                   SceGxmTextureFormat format) {
+    vita2d_texture *tex = calloc(1, sizeof(*tex));
+
+    if (!tex)
+        return NULL;
+
+    tex->width = w;
+    tex->height = h;
+    tex->format = format;
+    tex->stride = ((w + 7) & ~7u) * format_bpp(format);
+    tex->data = aligned_alloc(4096, ((size_t)tex->stride * h + 4095) & ~(size_t)4095);
+
+    if (format == SCE_GXM_TEXTURE_FORMAT_P8_ABGR)
+        tex->palette = calloc(256, sizeof(uint32_t));
+
+    if (!tex->data || (format == SCE_GXM_TEXTURE_FORMAT_P8_ABGR && !tex->palette)) {
+        vita2d_free_texture(tex);
+        return NULL;
+    }
+
+    memset(tex->data, 0, (size_t)tex->stride * h);
+    return tex;
+}
+
+vita2d_texture *vita2d_create_empty_texture(unsigned int w, unsigned int h) {
+    return vita2d_create_empty_texture_format(w, h, SCE_GXM_TEXTURE_FORMAT_A8B8G8R8);
+}
+
+vita2d_texture *vita2d_create_empty_texture_rendertarget(unsigned int w, unsigned int h,
+                                                         SceGxmTextureFormat format) {
+    return vita2d_create_empty_texture_format(w, h, format);
+}
+
+void vita2d_free_texture(vita2d_texture *texture) {
+    if (!texture)
+        return;
+
+    free(texture->data);
+    free(texture->palette);
+    free(texture);
+}
+
+unsigned int vita2d_texture_get_width(const vita2d_texture *texture) {
+    return texture->width;
+}
+
+unsigned int vita2d_texture_get_height(const vita2d_texture *texture) {
+    return texture->height;
+}
+
+unsigned int vita2d_texture_get_stride(const vita2d_texture *texture) {
+    return texture->stride;
+}
+
+void *vita2d_texture_get_datap(const vita2d_texture *texture) {
+    return texture->data;
+}
+
+void *vita2d_texture_get_palette(const vita2d_texture *texture) {
+    return texture->palette;
+}
+
+void vita2d_texture_set_filters(vita2d_texture *texture, SceGxmTextureFilter min_filter,
+                                SceGxmTextureFilter mag_filter) {
+    (void)texture;
+    (void)min_filter;
+    (void)mag_filter;
+}
+
+void vita2d_draw_texture(const vita2d_texture *texture, float x, float y) {
+    (void)texture;
+    (void)x;
+    (void)y;
+}
+
+void vita2d_draw_texture_scale(const vita2d_texture *texture, float x, float y,
+                               float x_scale, float y_scale) {
+    (void)texture;
+    (void)x;
+    (void)y;
+    (void)x_scale;
+    (void)y_scale;
+}
+
+void vita2d_draw_texture_part_scale(const vita2d_texture *texture, float x, float y,
+                                    float tex_x, float tex_y, float tex_w, float tex_h,
+                                    float x_scale, float y_scale) {
+    (void)texture;
+    (void)x;
+    (void)y;
+    (void)tex_x;
+    (void)tex_y;
+    (void)tex_w;
+    (void)tex_h;
+    (void)x_scale;
+    (void)y_scale;
+}
+
+void vita2d_draw_rectangle(float x, float y, float w, float h, unsigned int color) {
+    (void)x;
+    (void)y;
+    (void)w;
+    (void)h;
+    (void)color;
+}
+
+vita2d_pgf *vita2d_load_default_pgf(void) {
+    return calloc(1, sizeof(vita2d_pgf));
+}
+
+void vita2d_free_pgf(vita2d_pgf *font) {
+    free(font);
+}
+
+int vita2d_pgf_draw_text(vita2d_pgf *font, int x, int y, unsigned int color, float scale,
+                         const char *text) {
+    (void)font;
+    (void)x;
+    (void)y;
+    (void)color;
+    (void)scale;
+    return (int)strlen(text);
+}
+
+int vita2d_pgf_draw_textf(vita2d_pgf *font, int x, int y, unsigned int color, float scale,
+                          const char *text, ...) {
+    char buf[256];
+    va_list args;
+
+    va_start(args, text);
+    vsnprintf(buf, sizeof(buf), text, args);
+    va_end(args);
+
+    return vita2d_pgf_draw_text(font, x, y, color, scale, buf);
+}
@@ -0,0 +1,643 @@
+// Implementazione POSIX delle funzioni di VitaSDK usate dal livello di
+// piattaforma, per la build host (VITA_HOST_BUILD). Stesse firme e stessi
+// codici di ritorno (negativi in caso di errore) degli originali.
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <psp2/audioout.h>
+#include <psp2/ctrl.h>
+#include <psp2/display.h>
+#include <psp2/io/fcntl.h>
+#include <psp2/io/stat.h>
+#include <psp2/kernel/processmgr.h>
+#include <psp2/kernel/sysmem.h>
+#include <psp2/kernel/threadmgr.h>
+#include <psp2/power.h>
+
+#define SHIM_MAX_OBJECTS 256
+
+// Periodo del display della Vita (59.94 Hz)
+#define VBLANK_PERIOD_US 16683
+
+// Errori nel formato SCE: bit alto e errno nel byte basso
+#define SCE_ERROR(e) ((int)(0x80010000u | (unsigned)(e)))
+#define SCE_KERNEL_ERROR_ILLEGAL_MEMBLOCK_SIZE ((int)0x800200cb)
+#define SCE_KERNEL_ERROR_UNKNOWN_UID ((int)0x80020198)
+#define SCE_AUDIO_OUT_ERROR_INVALID_PORT ((int)0x80260003)
+#define SCE_AUDIO_OUT_ERROR_PORT_FULL ((int)0x80260002)
+
+#define SHIM_MAX_AUDIO_PORTS 8
+
+enum ShimKind {
+    SHIM_FREE,
+    SHIM_THREAD,
+    SHIM_SEMA,
+    SHIM_MEMBLOCK,
+};
+
+struct ShimThread {
+    pthread_t pthread;
+    int started;
+    SceKernelThreadEntry entry;
+    SceSize stack_size;
+    int affinity;
+    char name[16];
+    SceSize arglen;
+    void *argp;                     // copia degli argomenti, come sulla Vita
+    int exit_status;
+};
+
+struct ShimSema {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int count;
+    int max;
+};
+
+struct ShimMemBlock {
+    void *base;
+};
+
+struct ShimObject {
+    enum ShimKind kind;
+    union {
+        struct ShimThread thread;
+        struct ShimSema sema;
+        struct ShimMemBlock memblock;
+    } u;
+};
+
+static struct ShimObject objects[SHIM_MAX_OBJECTS];
+static pthread_mutex_t objects_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// UID del thread corrente: 0 per il thread principale, registrato alla
+// prima sceKernelGetThreadId
+static __thread SceUID current_thread = -1;
+
+// --- Oggetti ---
+
+static SceUID alloc_object(enum ShimKind kind) {
+    pthread_mutex_lock(&objects_lock);
+    for (int i = 0; i < SHIM_MAX_OBJECTS; i++) {
+        if (objects[i].kind == SHIM_FREE) {
+            memset(&objects[i], 0, sizeof(objects[i]));
+            objects[i].kind = kind;
+            pthread_mutex_unlock(&objects_lock);
+            return i + 1;
+        }
+    }
+    pthread_mutex_unlock(&objects_lock);
+    return -1;
+}
+
+static struct ShimObject *get_object(SceUID uid, enum ShimKind kind) {
+    if (uid < 1 || uid > SHIM_MAX_OBJECTS || objects[uid - 1].kind != kind)
+        return NULL;
+    return &objects[uid - 1];
+}
+
+static void free_object(SceUID uid) {
+    pthread_mutex_lock(&objects_lock);
+    objects[uid - 1].kind = SHIM_FREE;
+    pthread_mutex_unlock(&objects_lock);
+}
+
+// --- Tempo ---
+
+static SceUInt64 monotonic_us(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (SceUInt64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static SceUInt64 process_start_us(void) {
+    static SceUInt64 start = 0;
+
+    if (start == 0)
+        start = monotonic_us();
+    return start;
+}
+
+__attribute__((constructor))
+static void init_process_time(void) {
+    process_start_us();
+}
+
+SceUInt64 sceKernelGetProcessTimeWide(void) {
+    return monotonic_us() - process_start_us();
+}
+
+SceUInt32 sceKernelGetProcessTimeLow(void) {
+    return (SceUInt32)sceKernelGetProcessTimeWide();
+}
+
+int sceKernelDelayThread(SceUInt delay) {
+    struct timespec ts = { delay / 1000000, (delay % 1000000) * 1000 };
+
+    while (nanosleep(&ts, &ts) < 0 && errno == EINTR)
+        ;
+    return 0;
+}
+
+int sceKernelExitProcess(int res) {
+    exit(res);
+}
+
+// --- Display ---
+
+int sceDisplayGetVcount(void) {
+    return (int)(sceKernelGetProcessTimeWide() / VBLANK_PERIOD_US);
+}
+
+int sceDisplayWaitVblankStart(void) {
+    SceUInt64 now = sceKernelGetProcessTimeWide();
+    SceUInt64 next = (now / VBLANK_PERIOD_US + 1) * VBLANK_PERIOD_US;
+
+    sceKernelDelayThread((SceUInt)(next - now));
+    return 0;
+}
+
+// --- Pad ---
+
+int sceCtrlSetSamplingMode(int mode) {
+    (void)mode;
+    return 0;
+}
+
+static void idle_pad(SceCtrlData *pad) {
+    memset(pad, 0, sizeof(*pad));
+    pad->timeStamp = sceKernelGetProcessTimeWide();
+    pad->lx = pad->ly = pad->rx = pad->ry = 128;
+}
+
+int sceCtrlPeekBufferPositive(int port, SceCtrlData *pad, int count) {
+    (void)port;
+    for (int i = 0; i < count; i++)
+        idle_pad(&pad[i]);
+    return count;
+}
+
+// Bloccante fino al campionamento successivo, come sulla Vita
+int sceCtrlReadBufferPositive(int port, SceCtrlData *pad, int count) {
+    sceDisplayWaitVblankStart();
+    sceCtrlPeekBufferPositive(port, pad, 1);
+    (void)count;
+    return 1;
+}
+
+// --- Audio ---
+
+struct ShimAudioPort {
+    int open;
+    int len;                        // campioni per blocco
+    int freq;
+    SceUInt64 next_us;              // fine del blocco in riproduzione
+};
+
+static struct ShimAudioPort audio_ports[SHIM_MAX_AUDIO_PORTS];
+static pthread_mutex_t audio_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int sceAudioOutOpenPort(SceAudioOutPortType type, int len, int freq, SceAudioOutMode mode) {
+    (void)type;
+    (void)mode;
+
+    pthread_mutex_lock(&audio_lock);
+    for (int i = 0; i < SHIM_MAX_AUDIO_PORTS; i++) {
+        if (!audio_ports[i].open) {
+            audio_ports[i].open = 1;
+            audio_ports[i].len = len;
+            audio_ports[i].freq = freq;
+            audio_ports[i].next_us = 0;
+            pthread_mutex_unlock(&audio_lock);
+            return i;
+        }
+    }
+    pthread_mutex_unlock(&audio_lock);
+
+    return SCE_AUDIO_OUT_ERROR_PORT_FULL;
+}
+
+int sceAudioOutReleasePort(int port) {
+    if (port < 0 || port >= SHIM_MAX_AUDIO_PORTS || !audio_ports[port].open)
+        return SCE_AUDIO_OUT_ERROR_INVALID_PORT;
+
+    audio_ports[port].open = 0;
+    return 0;
+}
+
+// Il driver accoda un blocco mentre suona il precedente: si ritorna alla
+// fine del blocco in corso, e il nuovo finisce un periodo dopo
+int sceAudioOutOutput(int port, const void *buf) {
+    struct ShimAudioPort *p;
+    SceUInt64 now, period;
+
+    (void)buf;
+
+    if (port < 0 || port >= SHIM_MAX_AUDIO_PORTS || !audio_ports[port].open)
+        return SCE_AUDIO_OUT_ERROR_INVALID_PORT;
+
+    p = &audio_ports[port];
+    period = (SceUInt64)p->len * 1000000 / p->freq;
+    now = sceKernelGetProcessTimeWide();
+
+    if (p->next_us > now)
+        sceKernelDelayThread((SceUInt)(p->next_us - now));
+    else
+        p->next_us = now;       // buffer vuoto: il blocco parte subito
+
+    p->next_us += period;
+    return 0;
+}
+
+int sceAudioOutSetVolume(int port, int flag, int *vol) {
+    (void)flag;
+    (void)vol;
+
+    if (port < 0 || port >= SHIM_MAX_AUDIO_PORTS || !audio_ports[port].open)
+        return SCE_AUDIO_OUT_ERROR_INVALID_PORT;
+    return 0;
+}
+
+// --- Clock ---
+
+static int arm_clock = 333;
+
+int scePowerSetArmClockFrequency(int freq) {
+    arm_clock = freq;
+    return 0;
+}
+
+int scePowerSetBusClockFrequency(int freq) {
+    (void)freq;
+    return 0;
+}
+
+int scePowerSetGpuClockFrequency(int freq) {
+    (void)freq;
+    return 0;
+}
+
+int scePowerSetGpuXbarClockFrequency(int freq) {
+    (void)freq;
+    return 0;
+}
+
+int scePowerGetArmClockFrequency(void) {
+    return arm_clock;
+}
+
+// --- File ---
+
+SceUID sceIoOpen(const char *file, int flags, SceMode mode) {
+    int oflags;
+    int fd;
+
+    switch (flags & SCE_O_RDWR) {
+    case SCE_O_WRONLY: oflags = O_WRONLY; break;
+    case SCE_O_RDWR:   oflags = O_RDWR;   break;
+    default:           oflags = O_RDONLY; break;
+    }
+
+    if (flags & SCE_O_APPEND) oflags |= O_APPEND;
+    if (flags & SCE_O_CREAT)  oflags |= O_CREAT;
+    if (flags & SCE_O_TRUNC)  oflags |= O_TRUNC;
+    if (flags & SCE_O_EXCL)   oflags |= O_EXCL;
+
+    fd = open(file, oflags, mode);
+    return fd < 0 ? SCE_ERROR(errno) : fd;
+}
+
+int sceIoClose(SceUID fd) {
+    return close(fd) < 0 ? SCE_ERROR(errno) : 0;
+}
+
+int sceIoRead(SceUID fd, void *data, SceSize size) {
+    ssize_t got = read(fd, data, size);
+    return got < 0 ? SCE_ERROR(errno) : (int)got;
+}
+
+int sceIoWrite(SceUID fd, const void *data, SceSize size) {
+    ssize_t put = write(fd, data, size);
+    return put < 0 ? SCE_ERROR(errno) : (int)put;
+}
+
+SceOff sceIoLseek(SceUID fd, SceOff offset, int whence) {
+    off_t pos = lseek(fd, offset, whence == SCE_SEEK_END ? SEEK_END :
+                                  whence == SCE_SEEK_CUR ? SEEK_CUR : SEEK_SET);
+    return pos < 0 ? SCE_ERROR(errno) : pos;
+}
+
+int sceIoPread(SceUID fd, void *data, SceSize size, SceOff offset) {
+    ssize_t got = pread(fd, data, size, offset);
+    return got < 0 ? SCE_ERROR(errno) : (int)got;
+}
+
+int sceIoRemove(const char *file) {
+    return unlink(file) < 0 ? SCE_ERROR(errno) : 0;
+}
+
+int sceIoRename(const char *oldname, const char *newname) {
+    return rename(oldname, newname) < 0 ? SCE_ERROR(errno) : 0;
+}
+
+int sceIoMkdir(const char *dir, SceMode mode) {
+    return mkdir(dir, mode) < 0 ? SCE_ERROR(errno) : 0;
+}
+
+static void to_date_time(const struct timespec *ts, SceDateTime *dt) {
+    struct tm tm;
+
+    gmtime_r(&ts->tv_sec, &tm);
+    dt->year = tm.tm_year + 1900;
+    dt->month = tm.tm_mon + 1;
+    dt->day = tm.tm_mday;
+    dt->hour = tm.tm_hour;
+    dt->minute = tm.tm_min;
+    dt->second = tm.tm_sec;
+    dt->microsecond = ts->tv_nsec / 1000;
+}
+
+int sceIoGetstat(const char *file, SceIoStat *stat_out) {
+    struct stat st;
+
+    if (stat(file, &st) < 0)
+        return SCE_ERROR(errno);
+
+    memset(stat_out, 0, sizeof(*stat_out));
+    stat_out->st_mode = st.st_mode;
+    stat_out->st_size = st.st_size;
+    to_date_time(&st.st_ctim, &stat_out->st_ctime);
+    to_date_time(&st.st_atim, &stat_out->st_atime);
+    to_date_time(&st.st_mtim, &stat_out->st_mtime);
+    return 0;
+}
+
+// --- Memoria ---
+
+SceUID sceKernelAllocMemBlock(const char *name, SceUInt32 type, SceSize size, void *opt) {
+    struct ShimObject *obj;
+    SceUID uid;
+
+    (void)name;
+    (void)type;
+    (void)opt;
+
+    if (size == 0 || size % 4096 != 0)
+        return SCE_KERNEL_ERROR_ILLEGAL_MEMBLOCK_SIZE;
+
+    uid = alloc_object(SHIM_MEMBLOCK);
+    if (uid < 0)
+        return SCE_ERROR(ENOMEM);
+
+    obj = get_object(uid, SHIM_MEMBLOCK);
+    obj->u.memblock.base = aligned_alloc(4096, size);
+    if (!obj->u.memblock.base) {
+        free_object(uid);
+        return SCE_ERROR(ENOMEM);
+    }
+
+    return uid;
+}
+
+int sceKernelFreeMemBlock(SceUID uid) {
+    struct ShimObject *obj = get_object(uid, SHIM_MEMBLOCK);
+
+    if (!obj)
+        return SCE_KERNEL_ERROR_UNKNOWN_UID;
+
+    free(obj->u.memblock.base);
+    free_object(uid);
+    return 0;
+}
+
+int sceKernelGetMemBlockBase(SceUID uid, void **base) {
+    struct ShimObject *obj = get_object(uid, SHIM_MEMBLOCK);
+
+    if (!obj)
+        return SCE_KERNEL_ERROR_UNKNOWN_UID;
+
+    *base = obj->u.memblock.base;
+    return 0;
+}
+
+// --- Thread ---
+
+static void apply_affinity(pthread_t thread, int mask) {
+    cpu_set_t set;
+    int ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (!(mask & SCE_KERNEL_CPU_MASK_USER_ALL))
+        return;
+
+    CPU_ZERO(&set);
+    for (int core = 0; core < 3; core++)
+        if ((mask & (SCE_KERNEL_CPU_MASK_USER_0 << core)) && core < ncpu)
+            CPU_SET(core, &set);
+
+    if (CPU_COUNT(&set) > 0)
+        pthread_setaffinity_np(thread, sizeof(set), &set);
+}
+
+static void *thread_trampoline(void *arg) {
+    SceUID uid = (SceUID)(intptr_t)arg;
+    struct ShimThread *t = &objects[uid - 1].u.thread;
+
+    current_thread = uid;
+    t->exit_status = t->entry(t->arglen, t->argp);
+    return NULL;
+}
+
+SceUID sceKernelCreateThread(const char *name, SceKernelThreadEntry entry, int initPriority,
+                             SceSize stackSize, SceUInt attr, int cpuAffinityMask,
+                             const void *option) {
+    SceUID uid = alloc_object(SHIM_THREAD);
+    struct ShimThread *t;
+
+    (void)initPriority;
+    (void)attr;
+    (void)option;
+
+    if (uid < 0)
+        return SCE_ERROR(EAGAIN);
+
+    t = &objects[uid - 1].u.thread;
+    t->entry = entry;
+    t->stack_size = stackSize;
+    t->affinity = cpuAffinityMask;
+    snprintf(t->name, sizeof(t->name), "%s", name);
+    return uid;
+}
+
+int sceKernelStartThread(SceUID thid, SceSize arglen, void *argp) {
+    struct ShimObject *obj = get_object(thid, SHIM_THREAD);
+    struct ShimThread *t;
+    pthread_attr_t attr;
+    size_t stack;
+
+    if (!obj || obj->u.thread.started)
+        return SCE_KERNEL_ERROR_UNKNOWN_UID;
+    t = &obj->u.thread;
+
+    if (arglen > 0) {
+        t->argp = malloc(arglen);
+        memcpy(t->argp, argp, arglen);
+    }
+    t->arglen = arglen;
+
+    // Le pile della Vita sono piccole: sul host ne diamo almeno 256 KiB
+    stack = t->stack_size < 256 * 1024 ? 256 * 1024 : t->stack_size;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, stack);
+
+    if (pthread_create(&t->pthread, &attr, thread_trampoline, (void *)(intptr_t)thid) != 0) {
+        pthread_attr_destroy(&attr);
+        return SCE_ERROR(EAGAIN);
+    }
+    pthread_attr_destroy(&attr);
+
+    t->started = 1;
+    pthread_setname_np(t->pthread, t->name);
+    apply_affinity(t->pthread, t->affinity);
+    return 0;
+}
+
+int sceKernelWaitThreadEnd(SceUID thid, int *stat, SceUInt *timeout) {
+    struct ShimObject *obj = get_object(thid, SHIM_THREAD);
+
+    (void)timeout;
+
+    if (!obj || !obj->u.thread.started)
+        return SCE_KERNEL_ERROR_UNKNOWN_UID;
+
+    pthread_join(obj->u.thread.pthread, NULL);
+    obj->u.thread.started = 0;
+    if (stat)
+        *stat = obj->u.thread.exit_status;
+    return 0;
+}
+
+int sceKernelGetThreadId(void) {
+    if (current_thread < 0)
+        current_thread = 0;
+    return current_thread;
+}
+
+int sceKernelChangeThreadCpuAffinityMask(SceUID thid, int cpuAffinityMask) {
+    struct ShimObject *obj;
+
+    if (thid == 0 || thid == current_thread) {
+        apply_affinity(pthread_self(), cpuAffinityMask);
+        return 0;
+    }
+
+    obj = get_object(thid, SHIM_THREAD);
+    if (!obj)
+        return SCE_KERNEL_ERROR_UNKNOWN_UID;
+
+    obj->u.thread.affinity = cpuAffinityMask;
+    if (obj->u.thread.started)
+        apply_affinity(obj->u.thread.pthread, cpuAffinityMask);
+    return 0;
+}
+
+// --- Semafori ---
+
+SceUID sceKernelCreateSema(const char *name, SceUInt attr, int initVal, int maxVal, void *option) {
+    SceUID uid = alloc_object(SHIM_SEMA);
+    struct ShimSema *s;
+
+    (void)name;
+    (void)attr;
+    (void)option;
+
+    if (uid < 0)
+        return SCE_ERROR(EAGAIN);
+
+    s = &objects[uid - 1].u.sema;
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->cond, NULL);
+    s->count = initVal;
+    s->max = maxVal;
+    return uid;
+}
+
+int sceKernelDeleteSema(SceUID semaid) {
+    struct ShimObject *obj = get_object(semaid, SHIM_SEMA);
+
+    if (!obj)
+        return SCE_KERNEL_ERROR_UNKNOWN_UID;
+
+    pthread_cond_destroy(&obj->u.sema.cond);
+    pthread_mutex_destroy(&obj->u.sema.lock);
+    free_object(semaid);
+    return 0;
+}
+
+int sceKernelWaitSema(SceUID semaid, int signal, SceUInt *timeout) {
+    struct ShimObject *obj = get_object(semaid, SHIM_SEMA);
+    struct ShimSema *s;
+    struct timespec deadline;
+    int ret = 0;
+
+    if (!obj)
+        return SCE_KERNEL_ERROR_UNKNOWN_UID;
+    s = &obj->u.sema;
+
+    if (timeout) {
+        SceUInt64 ns;
+
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        ns = deadline.tv_nsec + (SceUInt64)*timeout * 1000;
+        deadline.tv_sec += ns / 1000000000;
+        deadline.tv_nsec = ns % 1000000000;
+    }
+
+    pthread_mutex_lock(&s->lock);
+    while (s->count < signal) {
+        if (!timeout) {
+            pthread_cond_wait(&s->cond, &s->lock);
+        } else if (pthread_cond_timedwait(&s->cond, &s->lock, &deadline) == ETIMEDOUT) {
+            ret = (int)SCE_KERNEL_ERROR_WAIT_TIMEOUT;
+            break;
+        }
+    }
+    if (ret == 0)
+        s->count -= signal;
+    pthread_mutex_unlock(&s->lock);
+
+    if (timeout && ret != 0)
+        *timeout = 0;
+    return ret;
+}
+
+int sceKernelSignalSema(SceUID semaid, int signal) {
+    struct ShimObject *obj = get_object(semaid, SHIM_SEMA);
+    struct ShimSema *s;
+    int ret = 0;
+
+    if (!obj)
+        return SCE_KERNEL_ERROR_UNKNOWN_UID;
+    s = &obj->u.sema;
+
+    pthread_mutex_lock(&s->lock);
+    if (s->count + signal > s->max) {
+        ret = (int)SCE_KERNEL_ERROR_SEMA_OVF;
+    } else {
+        s->count += signal;
+        pthread_cond_broadcast(&s->cond);
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return ret;
+}
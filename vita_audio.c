@@ -0,0 +1,531 @@
+#include "deh_str.h"
+#include "i_sound.h"
+#include "w_wad.h"
+#include "z_zone.h"
+#include <psp2/audioout.h>
+#include <psp2/kernel/threadmgr.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vita_config.h"
+#ifdef VITA_MUSIC
+#include "vita_music.h"
+#endif
+#ifdef VITA_STARTUP
+#include "vita_startup.h"
+#endif
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#define USE_NEON_MIX 1
+#endif
+
+// Modulo audio di doomgeneric (FEATURE_SOUND) sopra sceAudioOut: un thread
+// di mixaggio riempie blocchi di AUDIO_RATE / grain secondi e li passa a
+// sceAudioOutOutput, che blocca finche' il blocco precedente non e' stato
+// suonato. Il gioco comunica con il thread solo attraverso una coda SPSC
+// di comandi, quindi StartSound & co. costano pochi microsecondi.
+
+#define AUDIO_RATE 48000
+
+// Campioni per blocco (-audiograin): multiplo di 64 come vuole sceAudioOut
+#define AUDIO_GRAIN_DEFAULT 256         // 5.3 ms
+#define AUDIO_GRAIN_MIN 64
+#define AUDIO_GRAIN_MAX 2048
+
+#define AUDIO_MAX_CHANNELS 16
+
+#define AUDIO_CMD_QUEUE_SIZE 64         // potenza di due
+#define AUDIO_CMD_QUEUE_MASK (AUDIO_CMD_QUEUE_SIZE - 1)
+
+// Suono DMX decodificato: mono a 16 bit gia' ricampionato a AUDIO_RATE,
+// cosi' il mixaggio e' una moltiplicazione-accumulo su campioni contigui
+struct AudioSound {
+    int16_t *samples;
+    uint32_t length;
+};
+
+enum AudioCmdType {
+    AUDIO_CMD_START,
+    AUDIO_CMD_STOP,
+    AUDIO_CMD_PARAMS,
+};
+
+struct AudioCmd {
+    uint8_t type;
+    uint8_t channel;
+    uint16_t gain_l, gain_r;        // Q8: 256 = volume pieno
+    uint32_t seq;
+    const struct AudioSound *sound;
+};
+
+// Stato di un canale, toccato solo dal thread di mixaggio
+struct AudioChannel {
+    const struct AudioSound *sound;
+    uint32_t pos;
+    int gain_l, gain_r;
+    uint32_t seq;
+};
+
+// Variabili di configurazione che i_sound.c lega al file di configurazione:
+// upstream le definisce nei moduli SDL, esclusi da questa build
+int use_libsamplerate = 0;
+float libsamplerate_scale = 0.65f;
+char *timidity_cfg_path = "";
+
+static snddevice_t sound_devices[] = {
+    SNDDEVICE_SB,
+    SNDDEVICE_PAS,
+    SNDDEVICE_GUS,
+    SNDDEVICE_WAVEBLASTER,
+    SNDDEVICE_SOUNDCANVAS,
+    SNDDEVICE_AWE32,
+};
+
+static boolean use_sfx_prefix;
+
+// Suono che non si e' potuto decodificare: non si riprova a ogni StartSound
+static struct AudioSound invalid_sound;
+
+static int audio_port = -1;
+static SceUID audio_thread = -1;
+static volatile int audio_running = 0;
+static int audio_grain = AUDIO_GRAIN_DEFAULT;
+
+// Dal gioco al thread di mixaggio
+static struct AudioCmd cmd_queue[AUDIO_CMD_QUEUE_SIZE];
+static uint32_t cmd_head = 0;
+static uint32_t cmd_tail = 0;
+
+// Numeri di sequenza per SoundIsPlaying: started/stopped li scrive il
+// gioco, finished il thread di mixaggio quando un suono finisce
+static uint32_t started_seq[AUDIO_MAX_CHANNELS];
+static uint32_t stopped_seq[AUDIO_MAX_CHANNELS];
+static uint32_t finished_seq[AUDIO_MAX_CHANNELS];
+
+static struct AudioChannel channels[AUDIO_MAX_CHANNELS];
+static int32_t mix_l[AUDIO_GRAIN_MAX], mix_r[AUDIO_GRAIN_MAX];
+static int16_t out_buffers[2][AUDIO_GRAIN_MAX * 2] __attribute__((aligned(64)));
+
+// --- Decodifica ---
+
+static void get_sfx_lump_name(sfxinfo_t *sfx, char *buf, size_t buf_len) {
+    if (sfx->link != NULL)
+        sfx = sfx->link;
+
+    if (use_sfx_prefix)
+        snprintf(buf, buf_len, "ds%s", DEH_String(sfx->name));
+    else
+        snprintf(buf, buf_len, "%s", DEH_String(sfx->name));
+}
+
+// Lump DMX: formato 3, frequenza, numero di campioni a 8 bit senza segno
+// con 16 byte di riempimento in testa e in coda
+static const struct AudioSound *decode_sound(sfxinfo_t *sfx) {
+    struct AudioSound *sound;
+    const byte *data;
+    uint32_t lumplen, length, rate, out_len;
+    uint64_t step;
+
+    if (sfx->driver_data)
+        return sfx->driver_data;
+
+    sfx->driver_data = &invalid_sound;
+
+    if (sfx->lumpnum < 0)
+        return &invalid_sound;
+
+    data = W_CacheLumpNum(sfx->lumpnum, PU_STATIC);
+    lumplen = W_LumpLength(sfx->lumpnum);
+
+    if (lumplen < 8 || data[0] != 0x03 || data[1] != 0x00) {
+        W_ReleaseLumpNum(sfx->lumpnum);
+        return &invalid_sound;
+    }
+
+    rate = data[2] | (data[3] << 8);
+    length = data[4] | (data[5] << 8) | (data[6] << 16) | ((uint32_t)data[7] << 24);
+
+    if (rate == 0 || length > lumplen - 8 || length <= 48) {
+        W_ReleaseLumpNum(sfx->lumpnum);
+        return &invalid_sound;
+    }
+
+    data += 8 + 16;
+    length -= 32;
+
+    out_len = (uint64_t)length * AUDIO_RATE / rate;
+    sound = malloc(sizeof(*sound));
+    if (sound)
+        sound->samples = malloc(out_len * sizeof(int16_t));
+
+    if (!sound || !sound->samples) {
+        free(sound);
+        W_ReleaseLumpNum(sfx->lumpnum);
+        return &invalid_sound;
+    }
+
+    // Interpolazione lineare in virgola fissa 16.16
+    step = ((uint64_t)rate << 16) / AUDIO_RATE;
+    for (uint32_t i = 0; i < out_len; i++) {
+        uint64_t pos = i * step;
+        uint32_t idx = pos >> 16;
+        int frac = pos & 0xffff;
+        int a = (data[idx] - 128) << 8;
+        int b = idx + 1 < length ? (data[idx + 1] - 128) << 8 : a;
+
+        sound->samples[i] = a + (((b - a) * frac) >> 16);
+    }
+    sound->length = out_len;
+
+    W_ReleaseLumpNum(sfx->lumpnum);
+
+    sfx->driver_data = sound;
+    return sound;
+}
+
+// --- Mixaggio (thread audio) ---
+
+static void mix_channel(const int16_t *src, int count, int gain_l, int gain_r) {
+    int i = 0;
+
+#ifdef USE_NEON_MIX
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t s = vld1q_s16(src + i);
+
+        vst1q_s32(mix_l + i, vmlal_n_s16(vld1q_s32(mix_l + i), vget_low_s16(s), gain_l));
+        vst1q_s32(mix_l + i + 4, vmlal_n_s16(vld1q_s32(mix_l + i + 4), vget_high_s16(s), gain_l));
+        vst1q_s32(mix_r + i, vmlal_n_s16(vld1q_s32(mix_r + i), vget_low_s16(s), gain_r));
+        vst1q_s32(mix_r + i + 4, vmlal_n_s16(vld1q_s32(mix_r + i + 4), vget_high_s16(s), gain_r));
+    }
+#endif
+
+    for (; i < count; i++) {
+        mix_l[i] += src[i] * gain_l;
+        mix_r[i] += src[i] * gain_r;
+    }
+}
+
+// Da Q8 a 16 bit con saturazione, alternando sinistra e destra
+static void output_frames(int16_t *out, int count) {
+    int i = 0;
+
+#ifdef USE_NEON_MIX
+    for (; i + 4 <= count; i += 4) {
+        int16x4x2_t frames;
+
+        frames.val[0] = vqshrn_n_s32(vld1q_s32(mix_l + i), 8);
+        frames.val[1] = vqshrn_n_s32(vld1q_s32(mix_r + i), 8);
+        vst2_s16(out + i * 2, frames);
+    }
+#endif
+
+    for (; i < count; i++) {
+        int l = mix_l[i] >> 8, r = mix_r[i] >> 8;
+
+        out[i * 2] = l > 32767 ? 32767 : l < -32768 ? -32768 : l;
+        out[i * 2 + 1] = r > 32767 ? 32767 : r < -32768 ? -32768 : r;
+    }
+}
+
+static void finish_channel(int ch) {
+    __atomic_store_n(&finished_seq[ch], channels[ch].seq, __ATOMIC_RELEASE);
+    channels[ch].sound = NULL;
+}
+
+static void run_commands(void) {
+    uint32_t head = __atomic_load_n(&cmd_head, __ATOMIC_ACQUIRE);
+    uint32_t tail = cmd_tail;
+
+    for (; tail != head; tail++) {
+        const struct AudioCmd *cmd = &cmd_queue[tail & AUDIO_CMD_QUEUE_MASK];
+        struct AudioChannel *c = &channels[cmd->channel];
+
+        switch (cmd->type) {
+        case AUDIO_CMD_START:
+            if (c->sound)
+                finish_channel(cmd->channel);
+            c->sound = cmd->sound;
+            c->pos = 0;
+            c->seq = cmd->seq;
+            c->gain_l = cmd->gain_l;
+            c->gain_r = cmd->gain_r;
+            break;
+
+        case AUDIO_CMD_STOP:
+            if (c->sound)
+                finish_channel(cmd->channel);
+            break;
+
+        case AUDIO_CMD_PARAMS:
+            c->gain_l = cmd->gain_l;
+            c->gain_r = cmd->gain_r;
+            break;
+        }
+    }
+
+    __atomic_store_n(&cmd_tail, tail, __ATOMIC_RELEASE);
+}
+
+static void mix_grain(int16_t *out, int count) {
+    memset(mix_l, 0, count * sizeof(mix_l[0]));
+    memset(mix_r, 0, count * sizeof(mix_r[0]));
+
+    for (int ch = 0; ch < AUDIO_MAX_CHANNELS; ch++) {
+        struct AudioChannel *c = &channels[ch];
+        uint32_t n;
+
+        if (!c->sound)
+            continue;
+
+        n = c->sound->length - c->pos;
+        if (n > (uint32_t)count)
+            n = count;
+
+        mix_channel(c->sound->samples + c->pos, n, c->gain_l, c->gain_r);
+        c->pos += n;
+
+        if (c->pos >= c->sound->length)
+            finish_channel(ch);
+    }
+
+#ifdef VITA_MUSIC
+    vita_music_mix(mix_l, mix_r, count);
+#endif
+
+    output_frames(out, count);
+}
+
+static int audio_thread_main(SceSize args, void *argp) {
+    int which = 0;
+
+    while (audio_running) {
+        run_commands();
+        mix_grain(out_buffers[which], audio_grain);
+        sceAudioOutOutput(audio_port, out_buffers[which]);
+        which ^= 1;
+    }
+
+    return 0;
+}
+
+// --- Lato gioco ---
+
+static void push_command(const struct AudioCmd *cmd) {
+    uint32_t head = cmd_head;
+
+    // Il thread svuota la coda a ogni blocco: piena solo se e' fermo
+    while (head - __atomic_load_n(&cmd_tail, __ATOMIC_ACQUIRE) >= AUDIO_CMD_QUEUE_SIZE)
+        sceKernelDelayThread(100);
+
+    cmd_queue[head & AUDIO_CMD_QUEUE_MASK] = *cmd;
+    __atomic_store_n(&cmd_head, head + 1, __ATOMIC_RELEASE);
+}
+
+// Panning come i_sdlsound.c: sep 0..254, 128 al centro
+static void compute_gains(int vol, int sep, uint16_t *gain_l, uint16_t *gain_r) {
+    int left = ((254 - sep) * vol) / 127;
+    int right = (sep * vol) / 127;
+
+    *gain_l = left < 0 ? 0 : left > 255 ? 255 : left;
+    *gain_r = right < 0 ? 0 : right > 255 ? 255 : right;
+}
+
+static boolean I_Vita_InitSound(boolean _use_sfx_prefix) {
+    use_sfx_prefix = _use_sfx_prefix;
+
+    if (vita_config.audio_grain > 0)
+        audio_grain = vita_config.audio_grain;
+
+    audio_grain = (audio_grain + AUDIO_GRAIN_MIN - 1) & ~(AUDIO_GRAIN_MIN - 1);
+    if (audio_grain < AUDIO_GRAIN_MIN)
+        audio_grain = AUDIO_GRAIN_MIN;
+    else if (audio_grain > AUDIO_GRAIN_MAX)
+        audio_grain = AUDIO_GRAIN_MAX;
+
+    audio_port = sceAudioOutOpenPort(SCE_AUDIO_OUT_PORT_TYPE_MAIN, audio_grain, AUDIO_RATE,
+                                     SCE_AUDIO_OUT_MODE_STEREO);
+    if (audio_port < 0) {
+        printf("I_Vita_InitSound: sceAudioOutOpenPort failed (0x%08x)\n", audio_port);
+        return false;
+    }
+
+    int volume[2] = { SCE_AUDIO_VOLUME_0DB, SCE_AUDIO_VOLUME_0DB };
+    sceAudioOutSetVolume(audio_port, SCE_AUDIO_VOLUME_FLAG_L_CH | SCE_AUDIO_VOLUME_FLAG_R_CH,
+                         volume);
+
+    // Priorita' sopra il gioco e l'ingresso, sul core dei worker: un blocco
+    // mancato si sente, un frame in ritardo di 100 us no
+    audio_running = 1;
+    audio_thread = sceKernelCreateThread("cq_audio", audio_thread_main, 0x10000100 - 16,
+                                         0x4000, 0, SCE_KERNEL_CPU_MASK_USER_2, NULL);
+    if (audio_thread < 0 || sceKernelStartThread(audio_thread, 0, NULL) < 0) {
+        audio_running = 0;
+        sceAudioOutReleasePort(audio_port);
+        audio_port = -1;
+        return false;
+    }
+
+    return true;
+}
+
+static void I_Vita_ShutdownSound(void) {
+    if (audio_thread < 0)
+        return;
+
+    audio_running = 0;
+    sceKernelWaitThreadEnd(audio_thread, NULL, NULL);
+    sceAudioOutReleasePort(audio_port);
+    audio_thread = -1;
+    audio_port = -1;
+}
+
+static int I_Vita_GetSfxLumpNum(sfxinfo_t *sfx) {
+    char namebuf[9];
+
+    get_sfx_lump_name(sfx, namebuf, sizeof(namebuf));
+    return W_GetNumForName(namebuf);
+}
+
+static void I_Vita_UpdateSound(void) {
+    // Tutto il lavoro e' sul thread di mixaggio
+}
+
+static void I_Vita_UpdateSoundParams(int channel, int vol, int sep) {
+    struct AudioCmd cmd = { .type = AUDIO_CMD_PARAMS, .channel = channel };
+
+    if (channel < 0 || channel >= AUDIO_MAX_CHANNELS)
+        return;
+
+    compute_gains(vol, sep, &cmd.gain_l, &cmd.gain_r);
+    push_command(&cmd);
+}
+
+static int I_Vita_StartSound(sfxinfo_t *sfxinfo, int channel, int vol, int sep) {
+    struct AudioCmd cmd = { .type = AUDIO_CMD_START, .channel = channel };
+
+    if (channel < 0 || channel >= AUDIO_MAX_CHANNELS)
+        return -1;
+
+    cmd.sound = decode_sound(sfxinfo);
+    if (cmd.sound == &invalid_sound)
+        return -1;
+
+    cmd.seq = ++started_seq[channel];
+    compute_gains(vol, sep, &cmd.gain_l, &cmd.gain_r);
+    push_command(&cmd);
+
+    return channel;
+}
+
+static void I_Vita_StopSound(int channel) {
+    struct AudioCmd cmd = { .type = AUDIO_CMD_STOP, .channel = channel };
+
+    if (channel < 0 || channel >= AUDIO_MAX_CHANNELS)
+        return;
+
+    stopped_seq[channel] = started_seq[channel];
+    push_command(&cmd);
+}
+
+static boolean I_Vita_SoundIsPlaying(int channel) {
+    uint32_t seq;
+
+    if (channel < 0 || channel >= AUDIO_MAX_CHANNELS)
+        return false;
+
+    seq = started_seq[channel];
+    return seq != stopped_seq[channel] &&
+           seq != __atomic_load_n(&finished_seq[channel], __ATOMIC_ACQUIRE);
+}
+
+// La decodifica di tutti i suoni all'avvio toglie lavoro al primo
+// StartSound di ciascuno; con -fastboot resta rimandata
+static void I_Vita_PrecacheSounds(sfxinfo_t *sounds, int num_sounds) {
+#ifdef VITA_STARTUP
+    if (vita_fastboot)
+        return;
+#endif
+
+    for (int i = 0; i < num_sounds; i++) {
+        if (sounds[i].lumpnum < 0) {
+            char namebuf[9];
+
+            get_sfx_lump_name(&sounds[i], namebuf, sizeof(namebuf));
+            sounds[i].lumpnum = W_CheckNumForName(namebuf);
+        }
+        decode_sound(&sounds[i]);
+    }
+}
+
+sound_module_t DG_sound_module = {
+    sound_devices,
+    sizeof(sound_devices) / sizeof(*sound_devices),
+    I_Vita_InitSound,
+    I_Vita_ShutdownSound,
+    I_Vita_GetSfxLumpNum,
+    I_Vita_UpdateSound,
+    I_Vita_UpdateSoundParams,
+    I_Vita_StartSound,
+    I_Vita_StopSound,
+    I_Vita_SoundIsPlaying,
+    I_Vita_PrecacheSounds,
+};
+
+// --- Musica ---
+
+#ifndef VITA_MUSIC
+// Senza vita_music.c Init fallisce e i_sound.c resta senza musica
+static boolean I_Vita_InitMusic(void) {
+    return false;
+}
+
+static void I_Vita_ShutdownMusic(void) {
+}
+
+static void I_Vita_SetMusicVolume(int volume) {
+}
+
+static void I_Vita_PauseMusic(void) {
+}
+
+static void I_Vita_ResumeMusic(void) {
+}
+
+static void *I_Vita_RegisterSong(void *data, int len) {
+    return NULL;
+}
+
+static void I_Vita_UnRegisterSong(void *handle) {
+}
+
+static void I_Vita_PlaySong(void *handle, boolean looping) {
+}
+
+static void I_Vita_StopSong(void) {
+}
+
+static boolean I_Vita_MusicIsPlaying(void) {
+    return false;
+}
+
+static void I_Vita_PollMusic(void) {
+}
+
+music_module_t DG_music_module = {
+    sound_devices,
+    sizeof(sound_devices) / sizeof(*sound_devices),
+    I_Vita_InitMusic,
+    I_Vita_ShutdownMusic,
+    I_Vita_SetMusicVolume,
+    I_Vita_PauseMusic,
+    I_Vita_ResumeMusic,
+    I_Vita_RegisterSong,
+    I_Vita_UnRegisterSong,
+    I_Vita_PlaySong,
+    I_Vita_StopSong,
+    I_Vita_MusicIsPlaying,
+    I_Vita_PollMusic,
+};
+#endif
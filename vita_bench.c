@@ -0,0 +1,275 @@
+#include "doomgeneric.h"
+#include "doomstat.h"
+#include "m_argv.h"
+#include "w_wad.h"
+#include <psp2/kernel/processmgr.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "vita_bench.h"
+
+#define BENCH_JSON_PATH "ux0:data/ChexQuest/bench.json"
+
+// Commit del motore, dal CMakeLists
+#ifndef DOOMGENERIC_COMMIT
+#define DOOMGENERIC_COMMIT "unknown"
+#endif
+
+#ifndef VITA_BENCH_DEMOS
+#define VITA_BENCH_DEMOS "demo1,demo2,demo3"
+#endif
+
+#define BENCH_MAX_DEMOS 16
+#define BENCH_NAME_LEN 9
+
+// Frame tenuti in totale: le demo del gioco durano pochi minuti a 35 tic/s
+#define BENCH_MAX_FRAMES 65536
+
+// Acceso di fabbrica nel target chexquest2_bench e nella build PGO
+// strumentata; nelle altre serve -bench
+#ifndef VITA_BENCH_AUTOSTART
+#define VITA_BENCH_AUTOSTART 0
+#endif
+
+// Da libgcov, solo nella build strumentata: scrive i contatori. Debole
+// perche' il codice resti lo stesso con -fprofile-use
+extern void __gcov_dump(void) __attribute__((weak));
+
+struct BenchRun {
+    char demo[64];                  // lump, o file .lmp passato a mano
+    uint32_t first_frame;           // indice in frame_us
+    uint32_t frames;
+    uint32_t elapsed_us;
+    int tics;
+};
+
+struct BenchStats {
+    double avg_ms, p50_ms, p90_ms, p99_ms, max_ms;
+};
+
+int vita_bench_enabled = VITA_BENCH_AUTOSTART;
+int vita_bench_nopresent = 0;
+
+static char demo_names[BENCH_MAX_DEMOS][BENCH_NAME_LEN];
+static int num_demos = 0;
+static int next_demo = 1;           // la prima parte da -timedemo
+static const char *current_demo = "";
+
+static struct BenchRun runs[BENCH_MAX_DEMOS];
+static int num_runs = 0;
+static int running = 0;
+
+static uint32_t frame_us[BENCH_MAX_FRAMES];
+static uint32_t num_frames = 0;
+static uint32_t sorted[BENCH_MAX_FRAMES];
+
+static uint32_t run_start_us, last_frame_us;
+static int run_start_tic;
+
+static void parse_demo_list(void) {
+    const char *p = VITA_BENCH_DEMOS;
+
+    while (*p && num_demos < BENCH_MAX_DEMOS) {
+        int len = strcspn(p, ",");
+
+        if (len > 0 && len < BENCH_NAME_LEN) {
+            memcpy(demo_names[num_demos], p, len);
+            demo_names[num_demos][len] = '\0';
+            num_demos++;
+        }
+        p += len;
+        if (*p == ',')
+            p++;
+    }
+}
+
+static int has_arg(int argc, char **argv, const char *arg) {
+    for (int i = 1; i < argc; i++)
+        if (!strcasecmp(argv[i], arg))
+            return 1;
+    return 0;
+}
+
+char **vita_bench_args(int *argc, char **argv) {
+    char **out;
+    int n = *argc;
+
+    if (!vita_bench_enabled && !has_arg(*argc, argv, "-bench"))
+        return argv;
+    vita_bench_enabled = 1;
+
+    out = malloc((*argc + 7) * sizeof(char *));
+    parse_demo_list();
+    memcpy(out, argv, n * sizeof(char *));
+
+    // Senza vsync i frame non aspettano il display: misuriamo il gioco
+    if (!has_arg(*argc, argv, "-present")) {
+        out[n++] = "-present";
+        out[n++] = "novsync";
+    }
+
+#ifdef VITA_POWER
+    // Clock fisso, o il profilo automatico falserebbe i confronti
+    if (!has_arg(*argc, argv, "-clock")) {
+        out[n++] = "-clock";
+        out[n++] = "normal";
+    }
+#endif
+
+    if (!has_arg(*argc, argv, "-timedemo") && num_demos > 0) {
+        out[n++] = "-timedemo";
+        out[n++] = demo_names[0];
+        current_demo = demo_names[0];
+    } else {
+        // Demo scelta a mano: si cronometra solo quella
+        int p;
+
+        for (p = 1; p < *argc - 1 && strcasecmp(argv[p], "-timedemo"); p++)
+            ;
+        if (p < *argc - 1)
+            current_demo = argv[p + 1];
+        next_demo = num_demos;
+    }
+
+    out[n] = NULL;
+    *argc = n;
+    return out;
+}
+
+void vita_bench_init(void) {
+    if (!vita_bench_enabled)
+        return;
+    vita_bench_nopresent = M_CheckParm("-nopresent") > 0;
+}
+
+void vita_bench_frame(void) {
+    uint32_t now;
+
+    if (!vita_bench_enabled)
+        return;
+    now = sceKernelGetProcessTimeLow();
+
+    if (!timingdemo || !demoplayback) {
+        running = 0;
+        return;
+    }
+
+    // Il primo frame contiene il caricamento del livello: la misura parte
+    // dalla sua fine
+    if (!running) {
+        if (num_runs >= BENCH_MAX_DEMOS)
+            return;
+
+        runs[num_runs].first_frame = num_frames;
+        runs[num_runs].frames = 0;
+        run_start_us = last_frame_us = now;
+        run_start_tic = gametic;
+        running = 1;
+        return;
+    }
+
+    if (num_frames < BENCH_MAX_FRAMES) {
+        frame_us[num_frames++] = now - last_frame_us;
+        runs[num_runs].frames++;
+    }
+    last_frame_us = now;
+}
+
+static int compare_asc(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+// Percentili con il metodo nearest-rank
+static void compute_stats(const uint32_t *frames, uint32_t count, struct BenchStats *s) {
+    uint64_t total = 0;
+
+    memset(s, 0, sizeof(*s));
+    if (count == 0)
+        return;
+
+    memcpy(sorted, frames, count * sizeof(sorted[0]));
+    qsort(sorted, count, sizeof(sorted[0]), compare_asc);
+
+    for (uint32_t i = 0; i < count; i++)
+        total += sorted[i];
+
+    s->avg_ms = total / 1000.0 / count;
+    s->p50_ms = sorted[(count - 1) * 50 / 100] / 1000.0;
+    s->p90_ms = sorted[(count - 1) * 90 / 100] / 1000.0;
+    s->p99_ms = sorted[(count - 1) * 99 / 100] / 1000.0;
+    s->max_ms = sorted[count - 1] / 1000.0;
+}
+
+static void write_stats(FILE *f, const struct BenchStats *s, int tics, uint32_t frames,
+                        uint32_t elapsed_us) {
+    fprintf(f, "\"tics\": %d, \"frames\": %u, \"seconds\": %.3f, \"tics_per_second\": %.2f, ",
+            tics, (unsigned)frames, elapsed_us / 1e6,
+            elapsed_us ? tics * 1e6 / elapsed_us : 0.0);
+    fprintf(f, "\"frame_ms\": {\"avg\": %.3f, \"p50\": %.3f, \"p90\": %.3f, "
+            "\"p99\": %.3f, \"max\": %.3f}", s->avg_ms, s->p50_ms, s->p90_ms,
+            s->p99_ms, s->max_ms);
+}
+
+static void write_bench_json(void) {
+    struct BenchStats stats;
+    uint64_t elapsed = 0;
+    int tics = 0;
+
+    FILE *f = fopen(BENCH_JSON_PATH, "w");
+    if (!f)
+        return;
+
+    fprintf(f, "{\n  \"engine\": \"%s\",\n  \"resolution\": \"%dx%d\",\n"
+            "  \"nopresent\": %s,\n  \"nodraw\": %s,\n  \"demos\": [\n",
+            DOOMGENERIC_COMMIT, DOOMGENERIC_RESX, DOOMGENERIC_RESY,
+            vita_bench_nopresent ? "true" : "false", nodrawers ? "true" : "false");
+
+    for (int i = 0; i < num_runs; i++) {
+        const struct BenchRun *r = &runs[i];
+
+        compute_stats(frame_us + r->first_frame, r->frames, &stats);
+        fprintf(f, "    {\"demo\": \"%s\", ", r->demo);
+        write_stats(f, &stats, r->tics, r->frames, r->elapsed_us);
+        fprintf(f, "}%s\n", i + 1 < num_runs ? "," : "");
+
+        elapsed += r->elapsed_us;
+        tics += r->tics;
+    }
+
+    compute_stats(frame_us, num_frames, &stats);
+    fprintf(f, "  ],\n  \"total\": {");
+    write_stats(f, &stats, tics, num_frames, (uint32_t)elapsed);
+    fprintf(f, "}\n}\n");
+
+    fclose(f);
+}
+
+char *vita_bench_demo_done(void) {
+    if (running) {
+        struct BenchRun *r = &runs[num_runs++];
+
+        snprintf(r->demo, sizeof(r->demo), "%s", current_demo);
+        r->elapsed_us = last_frame_us - run_start_us;
+        r->tics = gametic - run_start_tic;
+        running = 0;
+    }
+
+    // Le demo che non ci sono nei WAD caricati si saltano
+    while (next_demo < num_demos) {
+        char *name = demo_names[next_demo++];
+
+        if (W_CheckNumForName(name) >= 0) {
+            current_demo = name;
+            return name;
+        }
+    }
+
+    write_bench_json();
+    // Non e' detto che l'uscita dal gioco passi dai distruttori di libgcov
+    if (__gcov_dump)
+        __gcov_dump();
+    return NULL;
+}
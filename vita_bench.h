@@ -0,0 +1,31 @@
+#ifndef VITA_BENCH_H
+#define VITA_BENCH_H
+
+// Benchmark senza interazione (target chexquest2_bench): -timedemo sulle
+// demo di VITA_BENCH_DEMOS una dopo l'altra, con i tempi di ogni frame.
+// Alla fine dell'ultima demo i risultati vanno in bench.json e il gioco esce.
+// Compilato con VITA_BENCH, si accende a runtime: di fabbrica nel target di
+// benchmark e nella build PGO strumentata, altrimenti con -bench.
+
+// 1 se il benchmark e' acceso; letto dai blocchi VITA_BENCH del gioco
+extern int vita_bench_enabled;
+
+// -nopresent: DG_DrawFrame non presenta nulla, si misura solo il motore
+extern int vita_bench_nopresent;
+
+// Da main, prima di doomgeneric_Create: aggiunge -timedemo con la prima
+// demo e -present novsync se non sono gia' tra i parametri. Se il benchmark
+// e' spento restituisce argv cosi' com'e'.
+char **vita_bench_args(int *argc, char **argv);
+
+// Da DG_Init
+void vita_bench_init(void);
+
+// Una volta per giro del loop principale, dopo doomgeneric_Tick
+void vita_bench_frame(void);
+
+// Da G_Ticker (engine/g_game_vita.c) a fine demo: la prossima
+// demo da cronometrare, oppure NULL dopo aver scritto bench.json
+char *vita_bench_demo_done(void);
+
+#endif
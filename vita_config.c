@@ -0,0 +1,324 @@
+#include "doomkeys.h"
+#include "m_argv.h"
+#include <psp2/io/fcntl.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "vita_config.h"
+
+// Il file e' piccolo: lo si legge tutto in una volta
+#define CONFIG_FILE_MAX 8192
+
+struct VitaConfig vita_config = {
+    .iwad = "ux0:data/ChexQuest/chex.wad",
+    .files = { "ux0:data/ChexQuest/chex2.wad" },
+    .num_files = 1,
+    .present = "vsync",
+    .scale = "stretch",
+    .clock = "auto",
+    .rthreads = -1,
+    .deadzone = -1,
+    // La mappatura storica di vita_input.c
+    .buttons = {
+        [VITA_BUTTON_UP] = KEY_UPARROW,
+        [VITA_BUTTON_DOWN] = KEY_DOWNARROW,
+        [VITA_BUTTON_LEFT] = KEY_LEFTARROW,
+        [VITA_BUTTON_RIGHT] = KEY_RIGHTARROW,
+        [VITA_BUTTON_CROSS] = KEY_RCTRL,
+        [VITA_BUTTON_SQUARE] = ' ',
+        [VITA_BUTTON_CIRCLE] = KEY_ESCAPE,
+        [VITA_BUTTON_TRIANGLE] = KEY_ENTER,
+        [VITA_BUTTON_LTRIGGER] = ',',
+        [VITA_BUTTON_RTRIGGER] = '.',
+        [VITA_BUTTON_START] = KEY_ESCAPE,
+    },
+};
+
+static const char *const button_names[VITA_NUM_BUTTONS] = {
+    [VITA_BUTTON_UP] = "up",
+    [VITA_BUTTON_DOWN] = "down",
+    [VITA_BUTTON_LEFT] = "left",
+    [VITA_BUTTON_RIGHT] = "right",
+    [VITA_BUTTON_CROSS] = "cross",
+    [VITA_BUTTON_SQUARE] = "square",
+    [VITA_BUTTON_CIRCLE] = "circle",
+    [VITA_BUTTON_TRIANGLE] = "triangle",
+    [VITA_BUTTON_LTRIGGER] = "ltrigger",
+    [VITA_BUTTON_RTRIGGER] = "rtrigger",
+    [VITA_BUTTON_START] = "start",
+};
+
+// Azioni assegnabili ai tasti: i tasti predefiniti dei comandi di Doom
+struct KeyName {
+    const char *name;
+    unsigned char key;
+};
+
+static const struct KeyName key_names[] = {
+    {"none", 0},
+    {"up", KEY_UPARROW},
+    {"down", KEY_DOWNARROW},
+    {"left", KEY_LEFTARROW},
+    {"right", KEY_RIGHTARROW},
+    {"fire", KEY_RCTRL},
+    {"use", ' '},
+    {"run", KEY_RSHIFT},
+    {"strafe", KEY_RALT},
+    {"strafeleft", ','},
+    {"straferight", '.'},
+    {"menu", KEY_ESCAPE},
+    {"enter", KEY_ENTER},
+    {"map", KEY_TAB},
+    {"weapon1", '1'},
+    {"weapon2", '2'},
+    {"weapon3", '3'},
+    {"weapon4", '4'},
+    {"weapon5", '5'},
+    {"weapon6", '6'},
+    {"weapon7", '7'},
+};
+
+// Scritto quando vita.cfg non c'e': gli stessi valori di vita_config
+static const char default_file[] =
+    "; Impostazioni di Chex Quest 2 per PS Vita. I parametri passati\n"
+    "; all'avvio (-present, -scale, -clock...) hanno la precedenza.\n"
+    "\n"
+    "[game]\n"
+    "iwad = ux0:data/ChexQuest/chex.wad\n"
+    "; una riga file = per ogni PWAD, al massimo 4\n"
+    "file = ux0:data/ChexQuest/chex2.wad\n"
+    "\n"
+    "[video]\n"
+    "; vsync | novsync | paced\n"
+    "present = vsync\n"
+    "; stretch | integer | aspect | sharp\n"
+    "scale = stretch\n"
+    "interpolate = 0\n"
+    "\n"
+    "[performance]\n"
+    "; auto | save | normal | high\n"
+    "clock = auto\n"
+    "; worker dei drawer, 0..2\n"
+    "rthreads = 2\n"
+    "\n"
+    "[audio]\n"
+    "; campioni per blocco, 64..2048\n"
+    "grain = 256\n"
+    "\n"
+    "[input]\n"
+    "deadzone = 15\n"
+    "stickcurve = 1.5\n"
+    "\n"
+    "[buttons]\n"
+    "; fire use run strafe strafeleft straferight menu enter map\n"
+    "; up down left right weapon1..weapon7 none\n"
+    "up = up\n"
+    "down = down\n"
+    "left = left\n"
+    "right = right\n"
+    "cross = fire\n"
+    "square = use\n"
+    "circle = menu\n"
+    "triangle = enter\n"
+    "ltrigger = strafeleft\n"
+    "rtrigger = straferight\n"
+    "start = menu\n";
+
+static char *trim(char *s) {
+    char *end;
+
+    while (isspace((unsigned char)*s))
+        s++;
+
+    end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1]))
+        *--end = '\0';
+
+    return s;
+}
+
+static void copy_name(char *dst, const char *value, size_t len) {
+    snprintf(dst, len, "%s", value);
+}
+
+static int parse_key(const char *value) {
+    for (int i = 0; i < sizeof(key_names) / sizeof(key_names[0]); i++)
+        if (!strcasecmp(value, key_names[i].name))
+            return key_names[i].key;
+
+    return -1;
+}
+
+static int set_button(const char *name, const char *value) {
+    for (int i = 0; i < VITA_NUM_BUTTONS; i++) {
+        if (strcasecmp(name, button_names[i]))
+            continue;
+
+        int key = parse_key(value);
+        if (key < 0)
+            return 0;
+
+        vita_config.buttons[i] = key;
+        return 1;
+    }
+
+    return 0;
+}
+
+// 0 se la chiave non e' conosciuta, per segnalarla nel log
+static int set_value(const char *section, const char *name, const char *value) {
+    struct VitaConfig *c = &vita_config;
+
+    if (!strcasecmp(section, "game")) {
+        if (!strcasecmp(name, "iwad")) {
+            copy_name(c->iwad, value, sizeof(c->iwad));
+            return 1;
+        }
+        if (!strcasecmp(name, "file")) {
+            static int file_lines = 0;
+
+            // La prima riga file sostituisce i PWAD predefiniti
+            if (file_lines++ == 0)
+                c->num_files = 0;
+            if (c->num_files < VITA_CONFIG_MAX_FILES && value[0])
+                copy_name(c->files[c->num_files++], value, sizeof(c->files[0]));
+            return 1;
+        }
+    } else if (!strcasecmp(section, "video")) {
+        if (!strcasecmp(name, "present")) {
+            copy_name(c->present, value, sizeof(c->present));
+            return 1;
+        }
+        if (!strcasecmp(name, "scale")) {
+            copy_name(c->scale, value, sizeof(c->scale));
+            return 1;
+        }
+        if (!strcasecmp(name, "interpolate")) {
+            c->interpolate = atoi(value) != 0;
+            return 1;
+        }
+    } else if (!strcasecmp(section, "performance")) {
+        if (!strcasecmp(name, "clock")) {
+            copy_name(c->clock, value, sizeof(c->clock));
+            return 1;
+        }
+        if (!strcasecmp(name, "rthreads")) {
+            c->rthreads = atoi(value);
+            return 1;
+        }
+    } else if (!strcasecmp(section, "audio")) {
+        if (!strcasecmp(name, "grain")) {
+            c->audio_grain = atoi(value);
+            return 1;
+        }
+    } else if (!strcasecmp(section, "input")) {
+        if (!strcasecmp(name, "deadzone")) {
+            c->deadzone = atoi(value);
+            return 1;
+        }
+        if (!strcasecmp(name, "stickcurve")) {
+            c->stick_curve = atof(value);
+            return 1;
+        }
+    } else if (!strcasecmp(section, "buttons")) {
+        return set_button(name, value);
+    }
+
+    return 0;
+}
+
+static void parse_file(char *text) {
+    char section[VITA_CONFIG_NAME_MAX] = "";
+    int line_no = 0;
+
+    for (char *line = text; line; ) {
+        char *next = strchr(line, '\n');
+        char *eq;
+
+        if (next)
+            *next++ = '\0';
+        line_no++;
+
+        line[strcspn(line, ";#")] = '\0';
+        line = trim(line);
+
+        if (line[0] == '[') {
+            char *end = strchr(line, ']');
+
+            if (end) {
+                *end = '\0';
+                copy_name(section, trim(line + 1), sizeof(section));
+            }
+        } else if (line[0] && (eq = strchr(line, '=')) != NULL) {
+            *eq = '\0';
+            if (!set_value(section, trim(line), trim(eq + 1)))
+                printf("vita_config: line %d: unknown [%s] %s\n", line_no, section, trim(line));
+        } else if (line[0]) {
+            printf("vita_config: line %d ignored\n", line_no);
+        }
+
+        line = next;
+    }
+}
+
+static void write_default_file(void) {
+    SceUID fd = sceIoOpen(VITA_CONFIG_PATH, SCE_O_WRONLY | SCE_O_CREAT | SCE_O_TRUNC, 0777);
+
+    if (fd < 0)
+        return;
+
+    sceIoWrite(fd, default_file, sizeof(default_file) - 1);
+    sceIoClose(fd);
+}
+
+void vita_config_load(void) {
+    SceUID fd = sceIoOpen(VITA_CONFIG_PATH, SCE_O_RDONLY, 0);
+    char *text;
+    int len;
+
+    if (fd < 0) {
+        write_default_file();
+        return;
+    }
+
+    text = malloc(CONFIG_FILE_MAX + 1);
+    if (!text) {
+        sceIoClose(fd);
+        return;
+    }
+
+    len = sceIoRead(fd, text, CONFIG_FILE_MAX);
+    sceIoClose(fd);
+
+    if (len > 0) {
+        text[len] = '\0';
+        parse_file(text);
+    }
+
+    free(text);
+}
+
+void vita_config_apply_args(void) {
+    struct VitaConfig *c = &vita_config;
+    int p;
+
+    if ((p = M_CheckParmWithArgs("-present", 1)) > 0)
+        copy_name(c->present, myargv[p + 1], sizeof(c->present));
+    if ((p = M_CheckParmWithArgs("-scale", 1)) > 0)
+        copy_name(c->scale, myargv[p + 1], sizeof(c->scale));
+    if (M_CheckParm("-interpolate"))
+        c->interpolate = 1;
+    if ((p = M_CheckParmWithArgs("-clock", 1)) > 0)
+        copy_name(c->clock, myargv[p + 1], sizeof(c->clock));
+    if ((p = M_CheckParmWithArgs("-rthreads", 1)) > 0)
+        c->rthreads = atoi(myargv[p + 1]);
+    if ((p = M_CheckParmWithArgs("-audiograin", 1)) > 0)
+        c->audio_grain = atoi(myargv[p + 1]);
+    if ((p = M_CheckParmWithArgs("-deadzone", 1)) > 0)
+        c->deadzone = atoi(myargv[p + 1]);
+    if ((p = M_CheckParmWithArgs("-stickcurve", 1)) > 0)
+        c->stick_curve = atof(myargv[p + 1]);
+}
@@ -0,0 +1,66 @@
+#ifndef VITA_CONFIG_H
+#define VITA_CONFIG_H
+
+// Impostazioni in ux0:data/ChexQuest/vita.cfg, un INI letto una volta sola
+// all'avvio: le sezioni e le chiavi finiscono in vita_config e i moduli
+// leggono solo i campi. I parametri della riga di comando (-present,
+// -scale, -clock, -rthreads...) hanno la precedenza sul file. Se il file
+// manca ne viene scritto uno con i valori predefiniti.
+
+#define VITA_CONFIG_PATH "ux0:data/ChexQuest/vita.cfg"
+
+#define VITA_CONFIG_PATH_MAX 256
+#define VITA_CONFIG_MAX_FILES 4
+#define VITA_CONFIG_NAME_MAX 16
+
+// Tasti della Vita rimappabili nella sezione [buttons]
+enum VitaButton {
+    VITA_BUTTON_UP,
+    VITA_BUTTON_DOWN,
+    VITA_BUTTON_LEFT,
+    VITA_BUTTON_RIGHT,
+    VITA_BUTTON_CROSS,
+    VITA_BUTTON_SQUARE,
+    VITA_BUTTON_CIRCLE,
+    VITA_BUTTON_TRIANGLE,
+    VITA_BUTTON_LTRIGGER,
+    VITA_BUTTON_RTRIGGER,
+    VITA_BUTTON_START,
+    VITA_NUM_BUTTONS
+};
+
+struct VitaConfig {
+    // [game]
+    char iwad[VITA_CONFIG_PATH_MAX];
+    char files[VITA_CONFIG_MAX_FILES][VITA_CONFIG_PATH_MAX];
+    int num_files;
+
+    // [video]: i nomi sono quelli di -present e -scale
+    char present[VITA_CONFIG_NAME_MAX];
+    char scale[VITA_CONFIG_NAME_MAX];
+    int interpolate;
+
+    // [performance]
+    char clock[VITA_CONFIG_NAME_MAX];
+    int rthreads;                       // -1 = tutti i worker
+
+    // [audio]
+    int audio_grain;                    // 0 = predefinito
+
+    // [input]
+    int deadzone;                       // -1 = predefinito
+    float stick_curve;                  // 0 = predefinito
+
+    // [buttons]: tasto di Doom per ogni VitaButton, 0 = nessuno
+    unsigned char buttons[VITA_NUM_BUTTONS];
+};
+
+extern struct VitaConfig vita_config;
+
+// Da main(), prima di costruire gli argomenti di doomgeneric_Create
+void vita_config_load(void);
+
+// Da DG_Init, prima di tutti i moduli: la riga di comando sopra al file
+void vita_config_apply_args(void);
+
+#endif
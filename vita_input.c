@@ -0,0 +1,317 @@
+#include "doomkeys.h"
+#include "m_argv.h"
+#include <psp2/ctrl.h>
+#include <psp2/kernel/processmgr.h>
+#include <psp2/kernel/threadmgr.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vita_config.h"
+#include "vita_input.h"
+#include "vita_prof.h"
+#ifdef VITA_SAVE
+#include "vita_save.h"
+#endif
+
+// Eventi in coda (potenza di due): a 60 campioni al secondo e un tic di
+// ritardo del gioco ne servono al massimo un paio di dozzine
+#define INPUT_QUEUE_SIZE 256
+#define INPUT_QUEUE_MASK (INPUT_QUEUE_SIZE - 1)
+
+// Campioni chiesti per lettura: il driver ne tiene 64, uno per vblank
+#define INPUT_BATCH 8
+
+// Valori predefiniti di -deadzone (percento della corsa) e -stickcurve
+#define STICK_DEADZONE 15
+#define STICK_CURVE 1.5f
+
+// Struttura per mappare i tasti Vita ai tasti di Doom
+struct ButtonMap {
+    uint32_t vita_btn;
+    unsigned char doom_key;
+};
+
+// Tasti della Vita nell'ordine di enum VitaButton
+static const uint32_t vita_buttons[VITA_NUM_BUTTONS] = {
+    [VITA_BUTTON_UP] = SCE_CTRL_UP,
+    [VITA_BUTTON_DOWN] = SCE_CTRL_DOWN,
+    [VITA_BUTTON_LEFT] = SCE_CTRL_LEFT,
+    [VITA_BUTTON_RIGHT] = SCE_CTRL_RIGHT,
+    [VITA_BUTTON_CROSS] = SCE_CTRL_CROSS,
+    [VITA_BUTTON_SQUARE] = SCE_CTRL_SQUARE,
+    [VITA_BUTTON_CIRCLE] = SCE_CTRL_CIRCLE,
+    [VITA_BUTTON_TRIANGLE] = SCE_CTRL_TRIANGLE,
+    [VITA_BUTTON_LTRIGGER] = SCE_CTRL_LTRIGGER,
+    [VITA_BUTTON_RTRIGGER] = SCE_CTRL_RTRIGGER,
+    [VITA_BUTTON_START] = SCE_CTRL_START,
+};
+
+// Mappatura tasti, costruita da vita_config.buttons in vita_input_init
+// (la predefinita: croce spara, quadrato usa, cerchio e START menu...)
+static struct ButtonMap bmap[VITA_NUM_BUTTONS];
+static int bmap_count = 0;
+
+// SELECT fa da modificatore: tenuto premuto, gli altri tasti attivano le
+// combinazioni qui sotto invece dei loro tasti di Doom. Da solo apre la
+// mappa (KEY_TAB) al rilascio, se non e' servito per una combinazione.
+#define COMBO_MODIFIER SCE_CTRL_SELECT
+#define COMBO_MODIFIER_KEY KEY_TAB
+
+// Le azioni girano sul thread dell'ingresso: devono solo cambiare un flag
+struct ButtonCombo {
+    uint32_t vita_btns;                // oltre a COMBO_MODIFIER
+    void (*action)(void);
+};
+
+static const struct ButtonCombo combos[] = {
+#ifdef VITA_PROFILER
+    {SCE_CTRL_LTRIGGER, vita_prof_toggle_overlay},  // Overlay prestazioni
+#endif
+#ifdef VITA_SAVE
+    {SCE_CTRL_SQUARE, vita_save_request_quicksave},     // Salvataggio rapido
+    {SCE_CTRL_TRIANGLE, vita_save_request_quickload},   // Caricamento rapido
+#endif
+    {0, NULL}
+};
+
+// Coda SPSC: scrive solo il thread dell'ingresso, legge solo il gioco
+static input_event_t queue[INPUT_QUEUE_SIZE];
+static uint32_t queue_head = 0;     // eventi scritti in totale
+static uint32_t queue_tail = 0;     // eventi letti in totale
+
+static SceCtrlData old_pad;
+static int combo_used = 0;
+static SceUInt64 last_sample = 0;   // timeStamp dell'ultimo campione visto
+static SceUID input_thread = -1;
+
+// lx, ly, rx, ry dell'ultimo campione, un byte ciascuno
+static uint32_t sticks = 0x80808080;
+static float stick_deadzone = STICK_DEADZONE / 100.0f;
+static float stick_curve = STICK_CURVE;
+
+// Statistiche, azzerate da vita_input_take_stats
+static uint32_t stat_events = 0;
+static uint32_t stat_latency_sum = 0;
+static uint32_t stat_latency_max = 0;
+static uint32_t stat_dropped = 0;
+static uint32_t last_drain_us = 0;  // ultima lettura della coda dal gioco
+
+// Aggiunge un evento tasto alla coda; se e' piena l'evento si perde ma
+// viene contato
+static void add_key(int key, int pressed, uint32_t time_us) {
+    uint32_t head = queue_head;
+
+    if (head - __atomic_load_n(&queue_tail, __ATOMIC_ACQUIRE) >= INPUT_QUEUE_SIZE) {
+        __atomic_fetch_add(&stat_dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    queue[head & INPUT_QUEUE_MASK] = (input_event_t)(
+        (key & 0xff) | (pressed ? 0x100 : 0) |
+        (((time_us / 1000) & INPUT_EVENT_TIME_MASK) << 9));
+    __atomic_store_n(&queue_head, head + 1, __ATOMIC_RELEASE);
+}
+
+static void process_sample(const SceCtrlData *pad, uint32_t time_us) {
+    int modifier = pad->buttons & COMBO_MODIFIER;
+
+    // Controlla variazioni di stato per ogni tasto. Con il modificatore
+    // premuto passano solo i rilasci, per non lasciare tasti bloccati.
+    for (int i = 0; i < bmap_count; i++) {
+        int old_p = (old_pad.buttons & bmap[i].vita_btn) ? 1 : 0;
+        int new_p = (pad->buttons & bmap[i].vita_btn) ? 1 : 0;
+
+        if (old_p != new_p && !(modifier && new_p)) {
+            add_key(bmap[i].doom_key, new_p, time_us);
+        }
+    }
+
+    if (modifier) {
+        for (int i = 0; combos[i].action; i++) {
+            uint32_t btns = combos[i].vita_btns;
+
+            if ((pad->buttons & btns) == btns && (old_pad.buttons & btns) != btns) {
+                combos[i].action();
+                combo_used = 1;
+            }
+        }
+    } else if (old_pad.buttons & COMBO_MODIFIER) {
+        if (!combo_used) {
+            add_key(COMBO_MODIFIER_KEY, 1, time_us);
+            add_key(COMBO_MODIFIER_KEY, 0, time_us);
+        }
+        combo_used = 0;
+    }
+
+    __atomic_store_n(&sticks, pad->lx | (pad->ly << 8) | (pad->rx << 16) |
+                     ((uint32_t)pad->ry << 24), __ATOMIC_RELAXED);
+
+    old_pad = *pad;
+}
+
+// Il timeStamp del driver ha un'altra origine: il campione piu' recente
+// della lettura si considera preso adesso, gli altri di conseguenza
+static void process_samples(const SceCtrlData *pads, int count, uint32_t now) {
+    SceUInt64 newest = pads[count - 1].timeStamp;
+
+    for (int i = 0; i < count; i++) {
+        // Le letture possono restituire campioni gia' visti
+        if (pads[i].timeStamp <= last_sample)
+            continue;
+
+        last_sample = pads[i].timeStamp;
+        process_sample(&pads[i], now - (uint32_t)(newest - pads[i].timeStamp));
+    }
+}
+
+static int input_thread_main(SceSize args, void *argp) {
+    SceCtrlData pads[INPUT_BATCH];
+
+    for (;;) {
+        // Si blocca fino al prossimo campione (vblank)
+        int n = sceCtrlReadBufferPositive(0, pads, INPUT_BATCH);
+
+        if (n <= 0) {
+            sceKernelDelayThread(1000);
+            continue;
+        }
+
+        process_samples(pads, n, sceKernelGetProcessTimeLow());
+    }
+
+    return 0;
+}
+
+void vita_input_init(void) {
+    bmap_count = 0;
+    for (int i = 0; i < VITA_NUM_BUTTONS; i++) {
+        if (vita_config.buttons[i]) {
+            bmap[bmap_count].vita_btn = vita_buttons[i];
+            bmap[bmap_count].doom_key = vita_config.buttons[i];
+            bmap_count++;
+        }
+    }
+
+    if (vita_config.deadzone >= 0)
+        stick_deadzone = vita_config.deadzone / 100.0f;
+    if (vita_config.stick_curve > 0)
+        stick_curve = vita_config.stick_curve;
+
+    if (stick_deadzone < 0 || stick_deadzone > 0.9f)
+        stick_deadzone = STICK_DEADZONE / 100.0f;
+    if (stick_curve < 0.5f || stick_curve > 4.0f)
+        stick_curve = STICK_CURVE;
+
+    sceCtrlSetSamplingMode(SCE_CTRL_MODE_ANALOG);
+    sceCtrlPeekBufferPositive(0, &old_pad, 1);
+    last_sample = old_pad.timeStamp;
+
+    if (M_CheckParm("-noinputthread"))
+        return;
+
+    // Sul core del gioco, ma con priorita' piu' alta: dorme quasi sempre
+    input_thread = sceKernelCreateThread("cq_input", input_thread_main, 0x10000100 - 8,
+                                         0x4000, 0, SCE_KERNEL_CPU_MASK_USER_0, NULL);
+    if (input_thread >= 0 && sceKernelStartThread(input_thread, 0, NULL) < 0)
+        input_thread = -1;
+}
+
+void vita_input_poll(void) {
+    SceCtrlData pad;
+
+    if (input_thread >= 0)
+        return;
+
+    sceCtrlPeekBufferPositive(0, &pad, 1);
+    process_samples(&pad, 1, sceKernelGetProcessTimeLow());
+}
+
+// Gli eventi in coda sono arrivati dopo l'ultima lettura: se da allora
+// sono passati meno di 128 ms i 7 bit del tempo bastano, altrimenti (un
+// caricamento di livello) si conta l'intervallo intero
+static void account_latency(const input_event_t *events, int count, uint32_t now) {
+    uint32_t since_drain = now - last_drain_us;
+    uint32_t sum = 0, max = 0;
+
+    for (int i = 0; i < count; i++) {
+        uint32_t latency = since_drain;
+
+        if (since_drain < INPUT_EVENT_TIME_MASK * 1000)
+            latency = ((now / 1000 - INPUT_EVENT_TIME_MS(events[i])) & INPUT_EVENT_TIME_MASK) * 1000;
+
+        sum += latency;
+        if (latency > max)
+            max = latency;
+    }
+
+    __atomic_fetch_add(&stat_events, count, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stat_latency_sum, sum, __ATOMIC_RELAXED);
+    if (max > __atomic_load_n(&stat_latency_max, __ATOMIC_RELAXED))
+        __atomic_store_n(&stat_latency_max, max, __ATOMIC_RELAXED);
+}
+
+int vita_input_pop_batch(input_event_t *events, int max) {
+    uint32_t head = __atomic_load_n(&queue_head, __ATOMIC_ACQUIRE);
+    uint32_t tail = queue_tail;
+    uint32_t now = sceKernelGetProcessTimeLow();
+    int n = 0;
+
+    while (tail != head && n < max) {
+        input_event_t e = queue[tail++ & INPUT_QUEUE_MASK];
+
+        events[n++] = e;
+        if (!INPUT_EVENT_PRESSED(e))
+            break;
+    }
+
+    __atomic_store_n(&queue_tail, tail, __ATOMIC_RELEASE);
+
+    if (n > 0)
+        account_latency(events, n, now);
+    last_drain_us = now;
+
+    return n;
+}
+
+void vita_input_take_stats(struct InputStats *stats) {
+    stats->events = __atomic_exchange_n(&stat_events, 0, __ATOMIC_RELAXED);
+    stats->latency_sum_us = __atomic_exchange_n(&stat_latency_sum, 0, __ATOMIC_RELAXED);
+    stats->latency_max_us = __atomic_exchange_n(&stat_latency_max, 0, __ATOMIC_RELAXED);
+    stats->dropped = __atomic_load_n(&stat_dropped, __ATOMIC_RELAXED);
+}
+
+// Oltre la zona morta la corsa residua va da 0 a 1, poi passa dalla curva
+static float shape(float magnitude) {
+    if (magnitude <= stick_deadzone)
+        return 0;
+
+    magnitude = (magnitude - stick_deadzone) / (1.0f - stick_deadzone);
+    if (magnitude > 1.0f)
+        magnitude = 1.0f;
+
+    return powf(magnitude, stick_curve);
+}
+
+static float axis(uint32_t value) {
+    return ((int)value - 128) / 127.0f;
+}
+
+void vita_input_analog(float *move_x, float *move_y, float *turn) {
+    uint32_t s = __atomic_load_n(&sticks, __ATOMIC_RELAXED);
+    float x = axis(s & 0xff), y = -axis((s >> 8) & 0xff);
+    float m = sqrtf(x * x + y * y);
+
+    // Zona morta radiale per il movimento, cosi' le diagonali non scattano
+    if (m > 0) {
+        float k = shape(m) / m;
+        x *= k;
+        y *= k;
+    }
+
+    *move_x = x > 1.0f ? 1.0f : x < -1.0f ? -1.0f : x;
+    *move_y = y > 1.0f ? 1.0f : y < -1.0f ? -1.0f : y;
+
+    x = axis((s >> 16) & 0xff);
+    *turn = x < 0 ? -shape(-x) : shape(x);
+}
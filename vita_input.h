@@ -0,0 +1,53 @@
+#ifndef VITA_INPUT_H
+#define VITA_INPUT_H
+
+#include <stdint.h>
+
+// Ingresso dal pad: un thread legge i campioni bufferizzati dal driver a
+// ogni vblank (sceCtrlReadBufferPositive), li trasforma in eventi tasto con
+// il tempo del campione e li passa al gioco con una coda SPSC senza lock.
+// Cosi' anche pressione e rilascio dentro lo stesso tic arrivano entrambi.
+
+// Evento impacchettato in 16 bit: tasto di Doom, pressione e i 7 bit bassi
+// del millisecondo del campione (per la latenza, valida sotto i 128 ms)
+typedef uint16_t input_event_t;
+
+#define INPUT_EVENT_KEY(e) ((unsigned char)((e) & 0xff))
+#define INPUT_EVENT_PRESSED(e) (((e) >> 8) & 1)
+#define INPUT_EVENT_TIME_MS(e) ((e) >> 9)
+#define INPUT_EVENT_TIME_MASK 0x7f
+
+// Eventi chiesti al massimo per lotto da I_GetEvent
+#define INPUT_EVENT_BATCH 32
+
+// Statistiche dall'ultima lettura: latenza campione -> DG_GetKey
+struct InputStats {
+    uint32_t events;
+    uint32_t latency_sum_us;
+    uint32_t latency_max_us;
+    uint32_t dropped;               // eventi persi a coda piena, in totale
+};
+
+// Da DG_Init: avvia il thread (se non c'e' -noinputthread)
+void vita_input_init(void);
+
+// Dal loop principale: senza thread legge qui il pad, altrimenti non fa nulla
+void vita_input_poll(void);
+
+// Dal thread del gioco: fino a max eventi in un colpo, fermandosi dopo il
+// primo rilascio (come il loop di I_GetEvent) perche' pressione e rilascio
+// arrivati insieme finiscano in due tic. Ritorna quanti ne ha scritti.
+int vita_input_pop_batch(input_event_t *events, int max);
+
+// Versione a lotti di DG_GetKey (doomgeneric_vita.c), per engine/i_input_vita.c
+int DG_GetKeys(input_event_t *events, int max);
+
+// Legge e azzera le statistiche di latenza (da qualunque thread)
+void vita_input_take_stats(struct InputStats *stats);
+
+// Levette dall'ultimo campione, tra -1 e 1 dopo zona morta (-deadzone,
+// percentuale) e curva di risposta (-stickcurve, esponente). move_y e'
+// positivo in avanti, turn verso destra.
+void vita_input_analog(float *move_x, float *move_y, float *turn);
+
+#endif
@@ -0,0 +1,195 @@
+#include "doomgeneric.h"
+#include "doomstat.h"
+#include "d_player.h"
+#include "p_local.h"
+#include "r_main.h"
+#include "hu_stuff.h"
+#include "i_video.h"
+#include "i_timer.h"
+#include "m_fixed.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vita_config.h"
+#include "vita_interp.h"
+
+// Capacita' delle tabelle di posizioni (potenza di due). Oltre 3/4 di
+// riempimento gli oggetti in piu' vengono semplicemente non interpolati.
+#define INTERP_HASH_SIZE 4096
+#define INTERP_MAX_MOBJS (INTERP_HASH_SIZE * 3 / 4)
+
+// Spostamento in un tic oltre il quale consideriamo l'oggetto teletrasportato
+#define INTERP_SNAP_DIST (64 * FRACUNIT)
+
+// Posizione di un oggetto all'ultimo tic
+struct InterpPos {
+    mobj_t *mo;
+    fixed_t x, y, z;
+    angle_t angle;
+};
+
+struct InterpTable {
+    struct InterpPos slots[INTERP_HASH_SIZE];
+    int used[INTERP_MAX_MOBJS];     // indici occupati, per scorrerli e svuotarli
+    int count;
+    fixed_t viewz;                  // viewz del giocatore visualizzato
+    mobj_t *view_mo;
+};
+
+int vita_interp_enabled = 0;
+
+static struct InterpTable tables[2];
+static struct InterpTable *prev_tab = &tables[0];
+static struct InterpTable *cur_tab = &tables[1];
+
+static int snap_gametic = -1;       // tic dell'ultima istantanea
+static int snap_leveltime = -1;
+static uint32_t snap_ms = 0;        // quando e' stata presa
+static player_t *interp_player = NULL;
+
+void vita_interp_init(void) {
+    vita_interp_enabled = vita_config.interpolate;
+}
+
+static unsigned int hash_mobj(const mobj_t *mo) {
+    return ((uint32_t)(uintptr_t)mo >> 4) * 2654435761u & (INTERP_HASH_SIZE - 1);
+}
+
+static void clear_table(struct InterpTable *t) {
+    for (int i = 0; i < t->count; i++)
+        t->slots[t->used[i]].mo = NULL;
+    t->count = 0;
+    t->view_mo = NULL;
+}
+
+static struct InterpPos *find_pos(struct InterpTable *t, const mobj_t *mo) {
+    unsigned int h = hash_mobj(mo);
+
+    while (t->slots[h].mo != NULL) {
+        if (t->slots[h].mo == mo)
+            return &t->slots[h];
+        h = (h + 1) & (INTERP_HASH_SIZE - 1);
+    }
+
+    return NULL;
+}
+
+static void add_pos(struct InterpTable *t, mobj_t *mo) {
+    unsigned int h = hash_mobj(mo);
+
+    if (t->count >= INTERP_MAX_MOBJS)
+        return;
+
+    while (t->slots[h].mo != NULL)
+        h = (h + 1) & (INTERP_HASH_SIZE - 1);
+
+    t->slots[h].mo = mo;
+    t->slots[h].x = mo->x;
+    t->slots[h].y = mo->y;
+    t->slots[h].z = mo->z;
+    t->slots[h].angle = mo->angle;
+    t->used[t->count++] = h;
+}
+
+// Registra le posizioni uscite dall'ultimo tic: quelle precedenti diventano
+// il punto di partenza dell'interpolazione.
+static void take_snapshot(player_t *player) {
+    struct InterpTable *t = prev_tab;
+
+    prev_tab = cur_tab;
+    cur_tab = t;
+    clear_table(cur_tab);
+
+    // Cambio di livello o caricamento: le posizioni vecchie non valgono piu'
+    if (leveltime < snap_leveltime || leveltime > snap_leveltime + TICRATE)
+        clear_table(prev_tab);
+
+    for (thinker_t *th = thinkercap.next; th != &thinkercap; th = th->next) {
+        if (th->function.acp1 == (actionf_p1) P_MobjThinker)
+            add_pos(cur_tab, (mobj_t *)th);
+    }
+
+    cur_tab->viewz = player->viewz;
+    cur_tab->view_mo = player->mo;
+
+    snap_gametic = gametic;
+    snap_leveltime = leveltime;
+    snap_ms = DG_GetTicksMs();
+}
+
+static fixed_t lerp(fixed_t from, fixed_t to, fixed_t frac) {
+    return from + FixedMul(to - from, frac);
+}
+
+void vita_interp_begin(player_t *player) {
+    fixed_t frac;
+
+    if (gametic != snap_gametic)
+        take_snapshot(player);
+
+    // Frazione di tic trascorsa dall'istantanea: a 0 mostriamo lo stato del
+    // tic precedente, verso 1 quello corrente (un tic di ritardo, come nei
+    // source port).
+    uint32_t elapsed = DG_GetTicksMs() - snap_ms;
+    if (elapsed * TICRATE >= 1000)
+        frac = FRACUNIT;
+    else
+        frac = (fixed_t)(((int64_t)elapsed * TICRATE * FRACUNIT) / 1000);
+
+    interp_player = player;
+
+    for (int i = 0; i < cur_tab->count; i++) {
+        struct InterpPos *cur = &cur_tab->slots[cur_tab->used[i]];
+        struct InterpPos *prev = find_pos(prev_tab, cur->mo);
+        mobj_t *mo = cur->mo;
+
+        if (prev == NULL)
+            continue;
+        if (abs(cur->x - prev->x) > INTERP_SNAP_DIST || abs(cur->y - prev->y) > INTERP_SNAP_DIST
+            || abs(cur->z - prev->z) > INTERP_SNAP_DIST)
+            continue;
+
+        mo->x = lerp(prev->x, cur->x, frac);
+        mo->y = lerp(prev->y, cur->y, frac);
+        mo->z = lerp(prev->z, cur->z, frac);
+
+        // La differenza con segno gestisce il passaggio per 0/360 gradi
+        mo->angle = prev->angle + (angle_t)FixedMul((int32_t)(cur->angle - prev->angle), frac);
+    }
+
+    if (prev_tab->view_mo == player->mo && cur_tab->view_mo == player->mo
+        && abs(cur_tab->viewz - prev_tab->viewz) <= INTERP_SNAP_DIST)
+        player->viewz = lerp(prev_tab->viewz, cur_tab->viewz, frac);
+}
+
+void vita_interp_end(void) {
+    // Rimette tutto com'era alla fine del tic: la simulazione non deve
+    // mai vedere le posizioni interpolate.
+    for (int i = 0; i < cur_tab->count; i++) {
+        struct InterpPos *cur = &cur_tab->slots[cur_tab->used[i]];
+
+        cur->mo->x = cur->x;
+        cur->mo->y = cur->y;
+        cur->mo->z = cur->z;
+        cur->mo->angle = cur->angle;
+    }
+
+    if (interp_player != NULL && cur_tab->view_mo == interp_player->mo)
+        interp_player->viewz = cur_tab->viewz;
+    interp_player = NULL;
+}
+
+int vita_interp_can_draw(void) {
+    return vita_interp_enabled && gamestate == GS_LEVEL && gametic > 0
+        && !menuactive && !automapactive && !paused
+        && players[displayplayer].mo != NULL;
+}
+
+// Stessa parte di D_Display che riguarda la vista: il resto dello schermo
+// (barra di stato, bordo) e' rimasto quello dell'ultimo tic.
+void vita_interp_draw_frame(void) {
+    R_RenderPlayerView(&players[displayplayer]);
+    HU_Drawer();
+    I_FinishUpdate();
+}
@@ -0,0 +1,21 @@
+#ifndef VITA_INTERP_H
+#define VITA_INTERP_H
+
+#include "d_player.h"
+
+// Rendering interpolato tra i tic di gioco (-interpolate)
+extern int vita_interp_enabled;
+
+void vita_interp_init(void);
+
+// Chiamate da R_RenderPlayerView (engine/r_main_vita.c) attorno al
+// rendering originale: spostano vista e oggetti nella posizione interpolata
+// e poi li rimettono dove li ha lasciati la simulazione.
+void vita_interp_begin(player_t *player);
+void vita_interp_end(void);
+
+// Frame extra tra due tic: solo in livello, senza menu/mappa/pausa
+int vita_interp_can_draw(void);
+void vita_interp_draw_frame(void);
+
+#endif
@@ -0,0 +1,1213 @@
+#include "i_sound.h"
+#include "w_wad.h"
+#include "z_zone.h"
+#include <psp2/io/fcntl.h>
+#include <psp2/io/stat.h>
+#include <psp2/kernel/threadmgr.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vita_music.h"
+
+// Modulo musica di doomgeneric: niente emulazione OPL in tempo reale. Al
+// RegisterSong il thread della musica cerca il brano nella cache; se manca
+// lo sintetizza (molto piu' veloce del tempo reale) e lo scrive compresso.
+// PlaySong apre il file e lo stesso thread lo legge a blocchi in due buffer
+// alternati, che il mixer di vita_audio.c decodifica a ogni blocco audio.
+
+#define MUSIC_RATE 24000                // raddoppiata a 48 kHz dal mixer
+#define MUS_TICRATE 140
+
+#define MUSIC_CACHE_DIR "ux0:data/ChexQuest/cache"
+#define MUSIC_CACHE_TMP_PATH MUSIC_CACHE_DIR "/mus_render.tmp"
+#define MUSIC_CACHE_MAGIC "CQMUSC01"    // da cambiare se cambia il sintetizzatore
+
+// IMA ADPCM a blocchi indipendenti: predittore e indice in testa, poi due
+// campioni per byte. Un blocco e' anche l'unita' di lettura e di loop.
+#define ADPCM_BLOCK_BYTES 1024
+#define ADPCM_BLOCK_SAMPLES ((ADPCM_BLOCK_BYTES - 4) * 2)
+
+// Blocchi per buffer di lettura: 16 KB, 1.4 s di musica
+#define STREAM_BLOCKS 16
+
+// Brani piu' lunghi (un MUS senza fine) vengono troncati, e cosi' le pause
+#define MUSIC_MAX_SECONDS (20 * 60)
+#define MUS_MAX_DELAY (MUS_TICRATE * 60)
+
+#define MUSIC_CMD_QUEUE_SIZE 32         // potenza di due
+#define MUSIC_CMD_QUEUE_MASK (MUSIC_CMD_QUEUE_SIZE - 1)
+
+// --- GENMIDI ---
+
+#define GENMIDI_HEADER "#OPL_II#"
+#define GENMIDI_INSTRS 175              // 128 strumenti + percussioni 35..81
+#define GENMIDI_FIXED_PITCH 0x0001
+
+#define MUS_PERCUSSION_CHANNEL 15
+
+struct GenmidiOp {
+    uint8_t tremolo;                    // registro 0x20: AM, VIB, EG-TYP, KSR, MULT
+    uint8_t attack;                     // 0x60: AR, DR
+    uint8_t sustain;                    // 0x80: SL, RR
+    uint8_t waveform;                   // 0xe0
+    uint8_t scale;                      // KSL
+    uint8_t level;                      // TL
+} __attribute__((packed));
+
+struct GenmidiVoice {
+    struct GenmidiOp modulator;
+    uint8_t feedback;                   // 0xc0: FB, CON
+    struct GenmidiOp carrier;
+    uint8_t unused;
+    int16_t base_note_offset;
+} __attribute__((packed));
+
+struct GenmidiInstr {
+    uint16_t flags;
+    uint8_t fine_tuning;
+    uint8_t fixed_note;
+    struct GenmidiVoice voices[2];
+} __attribute__((packed));
+
+// --- Sintetizzatore ---
+
+// Approssima l'OPL2 con le patch di GENMIDI (solo la prima voce): due
+// operatori con moltiplicatore, forma d'onda, feedback e inviluppo ADSR
+// lineare in dB, come l'originale, a 9 bit da 0.1875 dB
+#define SYNTH_VOICES 16
+#define ENV_MAX 511
+#define ENV_SHIFT 16
+#define SINE_BITS 10
+
+enum EnvStage {
+    ENV_OFF,
+    ENV_ATTACK,
+    ENV_DECAY,
+    ENV_SUSTAIN,
+    ENV_RELEASE,
+};
+
+struct SynthOp {
+    uint32_t phase, step;
+    int32_t env;                        // attenuazione, Q16
+    int stage;
+    int32_t attack, decay, release;     // incrementi per campione, Q16
+    int32_t sustain;                    // livello di sustain, Q16
+    int hold;                           // EG-TYP: fermo al sustain fino al rilascio
+    int level;                          // livello totale, in passi dell'inviluppo
+    int wave;
+    int mult;                           // moltiplicatore x2
+};
+
+struct SynthVoice {
+    int channel;                        // -1 se libera
+    int note;                           // nota MUS, per il rilascio
+    uint32_t age;
+    int fm;                             // 0 = operatori in parallelo
+    int feedback;
+    int fb[2];
+    int gain;                           // velocita' x volume del canale, Q14
+    struct SynthOp mod, car;
+};
+
+struct SynthChannel {
+    int instrument;
+    int volume;
+    int velocity;
+    int bend;                           // 0..255, 128 al centro: +-2 semitoni
+};
+
+struct Synth {
+    struct SynthVoice voices[SYNTH_VOICES];
+    struct SynthChannel channels[16];
+    uint32_t age;
+};
+
+static const int mult_x2[16] = { 1, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 20, 24, 24, 30, 30 };
+
+static int16_t sine_table[1 << SINE_BITS];
+static int16_t gain_table[ENV_MAX + 1];     // Q15
+static int32_t attack_rates[16], decay_rates[16];
+
+// --- Cache e stream ---
+
+struct MusicCacheHeader {
+    char magic[8];
+    uint64_t key;                       // hash del MUS e di GENMIDI
+    uint32_t rate;
+    uint32_t blocks;
+};
+
+enum SongState {
+    SONG_PENDING,
+    SONG_READY,
+    SONG_FAILED,
+};
+
+struct MusicSong {
+    byte *data;                         // copia del lump, fino al rendering
+    int len;
+    int state;                          // scritto solo dal thread della musica
+    char path[64];
+};
+
+struct StreamBuffer {
+    byte data[STREAM_BLOCKS * ADPCM_BLOCK_BYTES];
+    int blocks;
+    int eof;
+    int full;                           // 1 = del mixer, 0 = del thread
+};
+
+enum MusicCmdType {
+    MUSIC_CMD_REGISTER,
+    MUSIC_CMD_UNREGISTER,
+    MUSIC_CMD_PLAY,
+    MUSIC_CMD_STOP,
+};
+
+struct MusicCmd {
+    int type;
+    struct MusicSong *song;
+    int looping;
+    uint32_t seq;
+};
+
+struct ImaState {
+    int predictor;
+    int index;
+};
+
+static const int16_t ima_steps[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+    11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+    32767
+};
+
+static const int8_t ima_index_adjust[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+static snddevice_t music_devices[] = {
+    SNDDEVICE_PAS,
+    SNDDEVICE_GUS,
+    SNDDEVICE_WAVEBLASTER,
+    SNDDEVICE_SOUNDCANVAS,
+    SNDDEVICE_GENMIDI,
+    SNDDEVICE_AWE32,
+    SNDDEVICE_ADLIB,
+    SNDDEVICE_SB,
+};
+
+static const struct GenmidiInstr *genmidi;
+static uint64_t genmidi_key;
+
+static SceUID music_thread = -1;
+static SceUID music_sema = -1;          // comandi e buffer liberati
+static SceUID stream_lock = -1;         // stato dello stream tra thread e mixer
+static volatile int music_running = 0;
+static int music_ready = 0;
+
+// Dal gioco al thread della musica
+static struct MusicCmd cmd_queue[MUSIC_CMD_QUEUE_SIZE];
+static uint32_t cmd_head = 0;
+static uint32_t cmd_tail = 0;
+
+// Lato gioco
+static uint32_t play_seq = 0;
+static int song_playing = 0;
+static int music_paused = 0;
+static int music_gain = 0;              // Q8
+
+// Numero del PlaySong il cui brano e' finito (senza loop), dal mixer
+static uint32_t ended_seq = 0;
+
+// Lettura (thread della musica)
+static struct StreamBuffer streams[2];
+static struct MusicSong *stream_song;
+static SceUID stream_fd = -1;
+static uint32_t stream_blocks;
+static uint32_t stream_pos;             // prossimo blocco da leggere
+static int stream_looping;
+static int fill_buf;
+
+// Riproduzione (mixer, sotto stream_lock)
+static int stream_active = 0;
+static uint32_t stream_seq;
+static int play_buf, play_block;
+static int16_t decoded[ADPCM_BLOCK_SAMPLES];
+static int decoded_pos, decoded_len;
+static int prev_sample;
+
+// Rendering
+static struct Synth synth;
+static int16_t render_pcm[ADPCM_BLOCK_SAMPLES];
+static byte render_block[STREAM_BLOCKS * ADPCM_BLOCK_BYTES];
+
+// --- IMA ADPCM ---
+
+static int ima_decode_nibble(struct ImaState *s, int nibble) {
+    int step = ima_steps[s->index];
+    int diff = step >> 3;
+
+    if (nibble & 4)
+        diff += step;
+    if (nibble & 2)
+        diff += step >> 1;
+    if (nibble & 1)
+        diff += step >> 2;
+
+    s->predictor += (nibble & 8) ? -diff : diff;
+    if (s->predictor > 32767)
+        s->predictor = 32767;
+    else if (s->predictor < -32768)
+        s->predictor = -32768;
+
+    s->index += ima_index_adjust[nibble];
+    if (s->index < 0)
+        s->index = 0;
+    else if (s->index > 88)
+        s->index = 88;
+
+    return s->predictor;
+}
+
+static int ima_encode_sample(struct ImaState *s, int sample) {
+    int step = ima_steps[s->index];
+    int diff = sample - s->predictor;
+    int nibble = 0;
+
+    if (diff < 0) {
+        nibble = 8;
+        diff = -diff;
+    }
+    if (diff >= step) {
+        nibble |= 4;
+        diff -= step;
+    }
+    step >>= 1;
+    if (diff >= step) {
+        nibble |= 2;
+        diff -= step;
+    }
+    step >>= 1;
+    if (diff >= step)
+        nibble |= 1;
+
+    // Il codificatore segue il decodificatore, come deve
+    ima_decode_nibble(s, nibble);
+    return nibble;
+}
+
+static void ima_encode_block(struct ImaState *s, const int16_t *pcm, byte *out) {
+    out[0] = s->predictor & 0xff;
+    out[1] = (s->predictor >> 8) & 0xff;
+    out[2] = s->index;
+    out[3] = 0;
+
+    for (int i = 0; i < ADPCM_BLOCK_SAMPLES; i += 2) {
+        int lo = ima_encode_sample(s, pcm[i]);
+        int hi = ima_encode_sample(s, pcm[i + 1]);
+
+        out[4 + i / 2] = lo | (hi << 4);
+    }
+}
+
+static void ima_decode_block(const byte *in, int16_t *pcm) {
+    struct ImaState s;
+
+    s.predictor = (int16_t)(in[0] | (in[1] << 8));
+    s.index = in[2] > 88 ? 88 : in[2];
+
+    for (int i = 0; i < ADPCM_BLOCK_SAMPLES; i += 2) {
+        pcm[i] = ima_decode_nibble(&s, in[4 + i / 2] & 0x0f);
+        pcm[i + 1] = ima_decode_nibble(&s, in[4 + i / 2] >> 4);
+    }
+}
+
+// --- Sintetizzatore ---
+
+static void synth_init_tables(void) {
+    for (int i = 0; i < (1 << SINE_BITS); i++)
+        sine_table[i] = (int16_t)(sinf(i * 2 * 3.14159265f / (1 << SINE_BITS)) * 32767);
+
+    for (int i = 0; i <= ENV_MAX; i++)
+        gain_table[i] = (int16_t)(powf(10.0f, -i * 0.1875f / 20) * 32767);
+    gain_table[ENV_MAX] = 0;
+
+    // Tempi dell'OPL2 su tutta la scala: attacco 2826 ms e decadimento
+    // 39280 ms al rate 1, dimezzati a ogni rate successivo
+    for (int rate = 1; rate < 16; rate++) {
+        float samples_attack = 2826.0f * MUSIC_RATE / 1000 / (1 << (rate - 1));
+        float samples_decay = 39280.0f * MUSIC_RATE / 1000 / (1 << (rate - 1));
+
+        attack_rates[rate] = (int32_t)((ENV_MAX << ENV_SHIFT) / samples_attack) + 1;
+        decay_rates[rate] = (int32_t)((ENV_MAX << ENV_SHIFT) / samples_decay) + 1;
+    }
+    attack_rates[15] = ENV_MAX << ENV_SHIFT;
+}
+
+static void synth_reset(struct Synth *s) {
+    memset(s, 0, sizeof(*s));
+
+    for (int i = 0; i < SYNTH_VOICES; i++)
+        s->voices[i].channel = -1;
+
+    for (int i = 0; i < 16; i++) {
+        s->channels[i].volume = 100;
+        s->channels[i].velocity = 127;
+        s->channels[i].bend = 128;
+    }
+}
+
+static uint32_t note_step(int note, int bend) {
+    float freq = 440.0f * powf(2.0f, (note - 69 + (bend - 128) / 64.0f) / 12.0f);
+
+    return (uint32_t)(freq * 4294967296.0 / MUSIC_RATE);
+}
+
+static void op_setup(struct SynthOp *op, const struct GenmidiOp *patch, uint32_t step) {
+    op->phase = 0;
+    op->mult = mult_x2[patch->tremolo & 0x0f];
+    op->step = (uint32_t)((uint64_t)step * op->mult / 2);
+    op->hold = (patch->tremolo & 0x20) != 0;
+    op->attack = attack_rates[patch->attack >> 4];
+    op->decay = decay_rates[patch->attack & 0x0f];
+    op->release = decay_rates[patch->sustain & 0x0f];
+    op->sustain = ((patch->sustain >> 4) == 15 ? 31 * 16 : (patch->sustain >> 4) * 16) << ENV_SHIFT;
+    op->level = (patch->level & 0x3f) * 4;
+    op->wave = patch->waveform & 3;
+    op->env = ENV_MAX << ENV_SHIFT;
+    op->stage = ENV_ATTACK;
+}
+
+static const struct GenmidiInstr *channel_instrument(struct Synth *s, int channel, int note) {
+    if (channel == MUS_PERCUSSION_CHANNEL) {
+        if (note < 35 || note > 81)
+            return NULL;
+        return &genmidi[128 + note - 35];
+    }
+
+    return &genmidi[s->channels[channel].instrument];
+}
+
+static int instrument_note(const struct GenmidiInstr *instr, int note) {
+    if (instr->flags & GENMIDI_FIXED_PITCH)
+        note = instr->fixed_note;
+    else
+        note += instr->voices[0].base_note_offset;
+
+    return note < 0 ? 0 : note > 127 ? 127 : note;
+}
+
+// Voce libera, altrimenti la piu' vecchia in rilascio, altrimenti la piu'
+// vecchia in assoluto
+static struct SynthVoice *voice_alloc(struct Synth *s) {
+    struct SynthVoice *best = NULL;
+
+    for (int i = 0; i < SYNTH_VOICES; i++) {
+        struct SynthVoice *v = &s->voices[i];
+
+        if (v->channel < 0)
+            return v;
+
+        if (!best || (v->car.stage == ENV_RELEASE && best->car.stage != ENV_RELEASE) ||
+            ((v->car.stage == ENV_RELEASE) == (best->car.stage == ENV_RELEASE) &&
+             v->age < best->age))
+            best = v;
+    }
+
+    return best;
+}
+
+static void synth_note_on(struct Synth *s, int channel, int note) {
+    struct SynthChannel *c = &s->channels[channel];
+    const struct GenmidiInstr *instr = channel_instrument(s, channel, note);
+    const struct GenmidiVoice *patch;
+    struct SynthVoice *v;
+    uint32_t step;
+
+    if (!instr)
+        return;
+
+    patch = &instr->voices[0];
+    v = voice_alloc(s);
+    step = note_step(instrument_note(instr, note), channel == MUS_PERCUSSION_CHANNEL ? 128 : c->bend);
+
+    v->channel = channel;
+    v->note = note;
+    v->age = ++s->age;
+    v->fm = !(patch->feedback & 1);
+    v->feedback = (patch->feedback >> 1) & 7;
+    v->fb[0] = v->fb[1] = 0;
+    v->gain = c->velocity * c->volume;
+    op_setup(&v->mod, &patch->modulator, step);
+    op_setup(&v->car, &patch->carrier, step);
+}
+
+static void voice_release(struct SynthVoice *v) {
+    if (v->mod.stage != ENV_OFF)
+        v->mod.stage = ENV_RELEASE;
+    if (v->car.stage != ENV_OFF)
+        v->car.stage = ENV_RELEASE;
+}
+
+static void synth_note_off(struct Synth *s, int channel, int note) {
+    for (int i = 0; i < SYNTH_VOICES; i++) {
+        struct SynthVoice *v = &s->voices[i];
+
+        if (v->channel == channel && v->note == note && v->car.stage != ENV_RELEASE)
+            voice_release(v);
+    }
+}
+
+static void synth_all_off(struct Synth *s, int channel) {
+    for (int i = 0; i < SYNTH_VOICES; i++)
+        if (s->voices[i].channel == channel)
+            voice_release(&s->voices[i]);
+}
+
+static void synth_bend(struct Synth *s, int channel, int bend) {
+    s->channels[channel].bend = bend;
+
+    if (channel == MUS_PERCUSSION_CHANNEL)
+        return;
+
+    for (int i = 0; i < SYNTH_VOICES; i++) {
+        struct SynthVoice *v = &s->voices[i];
+        const struct GenmidiInstr *instr;
+        uint32_t step;
+
+        if (v->channel != channel)
+            continue;
+
+        instr = channel_instrument(s, channel, v->note);
+        step = note_step(instrument_note(instr, v->note), bend);
+        v->mod.step = (uint32_t)((uint64_t)step * v->mod.mult / 2);
+        v->car.step = (uint32_t)((uint64_t)step * v->car.mult / 2);
+    }
+}
+
+static void op_envelope(struct SynthOp *op) {
+    switch (op->stage) {
+    case ENV_ATTACK:
+        op->env -= op->attack;
+        if (op->env <= 0) {
+            op->env = 0;
+            op->stage = ENV_DECAY;
+        }
+        break;
+
+    case ENV_DECAY:
+        op->env += op->decay;
+        if (op->env >= op->sustain) {
+            op->env = op->sustain;
+            op->stage = ENV_SUSTAIN;
+        }
+        break;
+
+    case ENV_SUSTAIN:
+        if (op->hold)
+            break;
+        // Suono percussivo: continua a scendere con il rate di rilascio
+        // fallthrough
+    case ENV_RELEASE:
+        op->env += op->release;
+        if (op->env >= ENV_MAX << ENV_SHIFT) {
+            op->env = ENV_MAX << ENV_SHIFT;
+            op->stage = ENV_OFF;
+        }
+        break;
+    }
+}
+
+static int op_output(struct SynthOp *op, uint32_t phase_mod) {
+    int att = (op->env >> ENV_SHIFT) + op->level;
+    uint32_t phase = op->phase + phase_mod;
+    int idx = phase >> (32 - SINE_BITS);
+    int s = sine_table[idx];
+
+    op->phase += op->step;
+    op_envelope(op);
+
+    if (att >= ENV_MAX)
+        return 0;
+
+    switch (op->wave) {
+    case 1:                             // mezza sinusoide
+        s = s < 0 ? 0 : s;
+        break;
+    case 2:                             // sinusoide raddrizzata
+        s = s < 0 ? -s : s;
+        break;
+    case 3:                             // quarti di sinusoide
+        s = (idx & (1 << (SINE_BITS - 2))) ? 0 : s < 0 ? -s : s;
+        break;
+    }
+
+    return (s * gain_table[att]) >> 15;
+}
+
+static int voice_output(struct SynthVoice *v) {
+    uint32_t fb = 0;
+    int m, out;
+
+    // Feedback al massimo (7): +-2 periodi, come sull'OPL
+    if (v->feedback)
+        fb = (uint32_t)((v->fb[0] + v->fb[1]) >> 1) << (v->feedback + 11);
+
+    m = op_output(&v->mod, fb);
+    v->fb[0] = v->fb[1];
+    v->fb[1] = m;
+
+    if (v->fm)
+        out = op_output(&v->car, (uint32_t)m << 18);
+    else
+        out = (m + op_output(&v->car, 0)) >> 1;
+
+    if (v->car.stage == ENV_OFF && (v->fm || v->mod.stage == ENV_OFF))
+        v->channel = -1;
+
+    return (out * v->gain) >> 14;
+}
+
+static void synth_render(struct Synth *s, int16_t *out, int count) {
+    for (int i = 0; i < count; i++) {
+        int sum = 0;
+
+        for (int j = 0; j < SYNTH_VOICES; j++)
+            if (s->voices[j].channel >= 0)
+                sum += voice_output(&s->voices[j]);
+
+        sum >>= 1;
+        out[i] = sum > 32767 ? 32767 : sum < -32768 ? -32768 : sum;
+    }
+}
+
+// --- Cache ---
+
+static uint64_t fnv1a(uint64_t hash, const void *data, size_t len) {
+    const byte *p = data;
+
+    while (len--) {
+        hash ^= *p++;
+        hash *= 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+static boolean read_fully(SceUID fd, void *dest, unsigned int length) {
+    unsigned int done = 0;
+
+    while (done < length) {
+        int got = sceIoRead(fd, (byte *)dest + done, length - done);
+        if (got <= 0)
+            return false;
+        done += got;
+    }
+
+    return true;
+}
+
+static boolean read_header(SceUID fd, uint64_t key, struct MusicCacheHeader *header) {
+    return read_fully(fd, header, sizeof(*header)) &&
+           memcmp(header->magic, MUSIC_CACHE_MAGIC, 8) == 0 && header->key == key &&
+           header->rate == MUSIC_RATE && header->blocks > 0;
+}
+
+// --- Lettura ---
+
+static void refill_streams(void) {
+    while (stream_fd >= 0 && !__atomic_load_n(&streams[fill_buf].full, __ATOMIC_ACQUIRE)) {
+        struct StreamBuffer *b = &streams[fill_buf];
+
+        b->blocks = 0;
+        b->eof = 0;
+
+        while (b->blocks < STREAM_BLOCKS) {
+            uint32_t n = STREAM_BLOCKS - b->blocks;
+
+            if (stream_pos == stream_blocks) {
+                if (!stream_looping) {
+                    b->eof = 1;
+                    break;
+                }
+                stream_pos = 0;
+                sceIoLseek(stream_fd, sizeof(struct MusicCacheHeader), SCE_SEEK_SET);
+            }
+
+            if (n > stream_blocks - stream_pos)
+                n = stream_blocks - stream_pos;
+
+            if (!read_fully(stream_fd, b->data + b->blocks * ADPCM_BLOCK_BYTES,
+                            n * ADPCM_BLOCK_BYTES)) {
+                b->eof = 1;
+                break;
+            }
+
+            b->blocks += n;
+            stream_pos += n;
+        }
+
+        __atomic_store_n(&b->full, 1, __ATOMIC_RELEASE);
+        fill_buf ^= 1;
+
+        if (b->eof) {
+            sceIoClose(stream_fd);
+            stream_fd = -1;
+        }
+    }
+}
+
+static void stream_close(void) {
+    sceKernelWaitSema(stream_lock, 1, NULL);
+    stream_active = 0;
+    sceKernelSignalSema(stream_lock, 1);
+
+    if (stream_fd >= 0) {
+        sceIoClose(stream_fd);
+        stream_fd = -1;
+    }
+
+    streams[0].full = 0;
+    streams[1].full = 0;
+    stream_song = NULL;
+}
+
+static void stream_open(struct MusicSong *song, int looping, uint32_t seq) {
+    struct MusicCacheHeader header;
+
+    stream_close();
+
+    if (song->state != SONG_READY)
+        return;
+
+    stream_fd = sceIoOpen(song->path, SCE_O_RDONLY, 0);
+    if (stream_fd < 0)
+        return;
+
+    if (!read_header(stream_fd, fnv1a(genmidi_key, song->path, strlen(song->path)), &header)) {
+        sceIoClose(stream_fd);
+        stream_fd = -1;
+        return;
+    }
+
+    stream_song = song;
+    stream_blocks = header.blocks;
+    stream_pos = 0;
+    stream_looping = looping;
+    fill_buf = 0;
+    refill_streams();
+
+    sceKernelWaitSema(stream_lock, 1, NULL);
+    play_buf = 0;
+    play_block = 0;
+    decoded_pos = decoded_len = 0;
+    prev_sample = 0;
+    stream_seq = seq;
+    stream_active = 1;
+    sceKernelSignalSema(stream_lock, 1);
+}
+
+// --- Rendering ---
+
+struct MusReader {
+    const byte *p, *end;
+};
+
+static int mus_byte(struct MusReader *r) {
+    return r->p < r->end ? *r->p++ : -1;
+}
+
+struct MusicWriter {
+    SceUID fd;
+    struct ImaState ima;
+    int pcm_used;
+    int blocks_used;                    // blocchi in render_block
+    uint32_t blocks;                    // blocchi scritti in totale
+    int failed;
+};
+
+static void writer_flush(struct MusicWriter *w) {
+    int len = w->blocks_used * ADPCM_BLOCK_BYTES;
+
+    if (len > 0 && !w->failed && sceIoWrite(w->fd, render_block, len) != len)
+        w->failed = 1;
+    w->blocks_used = 0;
+}
+
+static void writer_block(struct MusicWriter *w) {
+    ima_encode_block(&w->ima, render_pcm, render_block + w->blocks_used * ADPCM_BLOCK_BYTES);
+    w->pcm_used = 0;
+    w->blocks++;
+
+    if (++w->blocks_used == STREAM_BLOCKS)
+        writer_flush(w);
+
+    // Un brano gia' in riproduzione non deve restare senza dati
+    refill_streams();
+}
+
+static void render_samples(struct MusicWriter *w, uint32_t count) {
+    while (count > 0) {
+        uint32_t n = ADPCM_BLOCK_SAMPLES - w->pcm_used;
+
+        if (n > count)
+            n = count;
+
+        synth_render(&synth, render_pcm + w->pcm_used, n);
+        w->pcm_used += n;
+        count -= n;
+
+        if (w->pcm_used == ADPCM_BLOCK_SAMPLES)
+            writer_block(w);
+    }
+}
+
+// Esegue gli eventi MUS fino alla fine della partitura e scrive il brano
+// nel file, con un tic (1/140 s) di risoluzione per i ritardi
+static boolean render_song(struct MusicSong *song, uint64_t key) {
+    static struct MusicWriter w;
+    struct MusicCacheHeader header;
+    struct MusReader r;
+    unsigned int score_len, score_start;
+    uint32_t max_blocks = (uint64_t)MUSIC_MAX_SECONDS * MUSIC_RATE / ADPCM_BLOCK_SAMPLES;
+    uint32_t frac = 0;
+    int done = 0;
+
+    if (song->len < 16 || memcmp(song->data, "MUS\x1a", 4) != 0)
+        return false;
+
+    score_len = song->data[4] | (song->data[5] << 8);
+    score_start = song->data[6] | (song->data[7] << 8);
+    if (score_start >= song->len)
+        return false;
+
+    r.p = song->data + score_start;
+    r.end = song->data + (score_start + score_len > song->len ? song->len : score_start + score_len);
+
+    w.fd = sceIoOpen(MUSIC_CACHE_TMP_PATH, SCE_O_WRONLY | SCE_O_CREAT | SCE_O_TRUNC, 0777);
+    if (w.fd < 0)
+        return false;
+
+    memset(&header, 0, sizeof(header));
+    w.ima.predictor = 0;
+    w.ima.index = 0;
+    w.pcm_used = 0;
+    w.blocks_used = 0;
+    w.blocks = 0;
+    w.failed = sceIoWrite(w.fd, &header, sizeof(header)) != sizeof(header);
+
+    synth_reset(&synth);
+
+    while (!done && !w.failed && w.blocks < max_blocks) {
+        int event = mus_byte(&r);
+        int channel = event & 0x0f;
+        int a, b;
+
+        switch ((event >> 4) & 7) {
+        case 0:                         // rilascio nota
+            if ((a = mus_byte(&r)) < 0)
+                done = 1;
+            else
+                synth_note_off(&synth, channel, a & 0x7f);
+            break;
+
+        case 1:                         // nota, con velocita' se c'e' il bit alto
+            if ((a = mus_byte(&r)) < 0 || ((a & 0x80) && (b = mus_byte(&r)) < 0)) {
+                done = 1;
+                break;
+            }
+            if (a & 0x80)
+                synth.channels[channel].velocity = b & 0x7f;
+            synth_note_on(&synth, channel, a & 0x7f);
+            break;
+
+        case 2:                         // pitch bend
+            if ((a = mus_byte(&r)) < 0)
+                done = 1;
+            else
+                synth_bend(&synth, channel, a);
+            break;
+
+        case 3:                         // evento di sistema
+            if ((a = mus_byte(&r)) < 0)
+                done = 1;
+            else if (a == 10 || a == 11)
+                synth_all_off(&synth, channel);
+            else if (a == 14) {
+                synth.channels[channel].volume = 100;
+                synth_bend(&synth, channel, 128);
+            }
+            break;
+
+        case 4:                         // controller
+            if ((a = mus_byte(&r)) < 0 || (b = mus_byte(&r)) < 0) {
+                done = 1;
+                break;
+            }
+            if (a == 0 && channel != MUS_PERCUSSION_CHANNEL)
+                synth.channels[channel].instrument = b & 0x7f;
+            else if (a == 3)
+                synth.channels[channel].volume = b & 0x7f;
+            break;
+
+        case 5:                         // fine battuta
+            break;
+
+        default:                        // fine partitura (6) o sconosciuto
+            done = 1;
+            break;
+        }
+
+        if (!done && (event & 0x80)) {
+            uint32_t ticks = 0;
+
+            do {
+                if ((a = mus_byte(&r)) < 0) {
+                    done = 1;
+                    break;
+                }
+                ticks = (ticks << 7) | (a & 0x7f);
+            } while ((a & 0x80) && ticks < MUS_MAX_DELAY);
+
+            if (ticks > MUS_MAX_DELAY)
+                ticks = MUS_MAX_DELAY;
+
+            frac += ticks * MUSIC_RATE;
+            render_samples(&w, frac / MUS_TICRATE);
+            frac %= MUS_TICRATE;
+        }
+    }
+
+    // Ultimo blocco completato con silenzio
+    if (w.pcm_used > 0) {
+        memset(render_pcm + w.pcm_used, 0, (ADPCM_BLOCK_SAMPLES - w.pcm_used) * sizeof(int16_t));
+        writer_block(&w);
+    }
+    writer_flush(&w);
+
+    memcpy(header.magic, MUSIC_CACHE_MAGIC, 8);
+    header.key = key;
+    header.rate = MUSIC_RATE;
+    header.blocks = w.blocks;
+
+    if (!w.failed && w.blocks > 0 && sceIoLseek(w.fd, 0, SCE_SEEK_SET) == 0 &&
+        sceIoWrite(w.fd, &header, sizeof(header)) == sizeof(header)) {
+        sceIoClose(w.fd);
+        return true;
+    }
+
+    sceIoClose(w.fd);
+    return false;
+}
+
+// Il nome del file viene dall'hash del MUS e di GENMIDI: la chiave
+// nell'intestazione e' quella del nome, per riconoscere file estranei
+static void register_song(struct MusicSong *song) {
+    struct MusicCacheHeader header;
+    uint64_t key;
+    SceUID fd;
+
+    snprintf(song->path, sizeof(song->path), MUSIC_CACHE_DIR "/mus_%016llx.adp",
+             (unsigned long long)fnv1a(genmidi_key, song->data, song->len));
+    key = fnv1a(genmidi_key, song->path, strlen(song->path));
+
+    fd = sceIoOpen(song->path, SCE_O_RDONLY, 0);
+    if (fd >= 0) {
+        int valid = read_header(fd, key, &header);
+
+        sceIoClose(fd);
+        if (valid) {
+            song->state = SONG_READY;
+            goto done;
+        }
+    }
+
+    // Passa da un file temporaneo: un brano a meta' non deve mai sembrare
+    // valido
+    sceIoMkdir(MUSIC_CACHE_DIR, 0777);
+
+    if (render_song(song, key)) {
+        sceIoRemove(song->path);
+        if (sceIoRename(MUSIC_CACHE_TMP_PATH, song->path) >= 0) {
+            song->state = SONG_READY;
+            goto done;
+        }
+    }
+
+    sceIoRemove(MUSIC_CACHE_TMP_PATH);
+    song->state = SONG_FAILED;
+
+done:
+    free(song->data);
+    song->data = NULL;
+}
+
+// --- Thread della musica ---
+
+static void run_commands(void) {
+    uint32_t head = __atomic_load_n(&cmd_head, __ATOMIC_ACQUIRE);
+    uint32_t tail = cmd_tail;
+
+    for (; tail != head; tail++) {
+        const struct MusicCmd *cmd = &cmd_queue[tail & MUSIC_CMD_QUEUE_MASK];
+
+        switch (cmd->type) {
+        case MUSIC_CMD_REGISTER:
+            register_song(cmd->song);
+            break;
+
+        case MUSIC_CMD_UNREGISTER:
+            if (stream_song == cmd->song)
+                stream_close();
+            free(cmd->song->data);
+            free(cmd->song);
+            break;
+
+        case MUSIC_CMD_PLAY:
+            stream_open(cmd->song, cmd->looping, cmd->seq);
+            break;
+
+        case MUSIC_CMD_STOP:
+            stream_close();
+            break;
+        }
+
+        __atomic_store_n(&cmd_tail, tail + 1, __ATOMIC_RELEASE);
+    }
+}
+
+static int music_thread_main(SceSize args, void *argp) {
+    while (music_running) {
+        sceKernelWaitSema(music_sema, 1, NULL);
+        run_commands();
+        refill_streams();
+    }
+
+    stream_close();
+    return 0;
+}
+
+// --- Mixer (thread audio) ---
+
+// Prossimo blocco da decodificare; 0 se la lettura e' in ritardo o il
+// brano e' finito
+static int next_block(void) {
+    struct StreamBuffer *b = &streams[play_buf];
+
+    if (!__atomic_load_n(&b->full, __ATOMIC_ACQUIRE))
+        return 0;
+
+    if (play_block == b->blocks) {
+        int eof = b->eof;
+
+        __atomic_store_n(&b->full, 0, __ATOMIC_RELEASE);
+        sceKernelSignalSema(music_sema, 1);
+        play_buf ^= 1;
+        play_block = 0;
+
+        if (eof) {
+            stream_active = 0;
+            __atomic_store_n(&ended_seq, stream_seq, __ATOMIC_RELEASE);
+            return 0;
+        }
+
+        b = &streams[play_buf];
+        if (!__atomic_load_n(&b->full, __ATOMIC_ACQUIRE) || b->blocks == 0)
+            return 0;
+    }
+
+    ima_decode_block(b->data + play_block++ * ADPCM_BLOCK_BYTES, decoded);
+    decoded_pos = 0;
+    decoded_len = ADPCM_BLOCK_SAMPLES;
+    return 1;
+}
+
+void vita_music_mix(int32_t *mix_l, int32_t *mix_r, int count) {
+    int gain = __atomic_load_n(&music_gain, __ATOMIC_RELAXED);
+
+    if (!music_ready || __atomic_load_n(&music_paused, __ATOMIC_RELAXED))
+        return;
+
+    sceKernelWaitSema(stream_lock, 1, NULL);
+
+    // Ogni campione a 24 kHz diventa due: la media con il precedente e se
+    // stesso
+    for (int i = 0; stream_active && i < count; i += 2) {
+        int s, mid;
+
+        if (decoded_pos == decoded_len && !next_block())
+            break;
+
+        s = decoded[decoded_pos++];
+        mid = (prev_sample + s) >> 1;
+        prev_sample = s;
+
+        mix_l[i] += mid * gain;
+        mix_r[i] += mid * gain;
+        mix_l[i + 1] += s * gain;
+        mix_r[i + 1] += s * gain;
+    }
+
+    sceKernelSignalSema(stream_lock, 1);
+}
+
+// --- Lato gioco ---
+
+static void push_command(const struct MusicCmd *cmd) {
+    uint32_t head = cmd_head;
+
+    // Durante un rendering il thread non legge: si aspetta il suo turno
+    while (head - __atomic_load_n(&cmd_tail, __ATOMIC_ACQUIRE) >= MUSIC_CMD_QUEUE_SIZE)
+        sceKernelDelayThread(1000);
+
+    cmd_queue[head & MUSIC_CMD_QUEUE_MASK] = *cmd;
+    __atomic_store_n(&cmd_head, head + 1, __ATOMIC_RELEASE);
+    sceKernelSignalSema(music_sema, 1);
+}
+
+static boolean I_Vita_InitMusic(void) {
+    int lump = W_CheckNumForName("GENMIDI");
+
+    if (lump < 0 || W_LumpLength(lump) < 8 + GENMIDI_INSTRS * sizeof(struct GenmidiInstr))
+        return false;
+
+    genmidi = W_CacheLumpNum(lump, PU_STATIC);
+    if (memcmp(genmidi, GENMIDI_HEADER, 8) != 0)
+        return false;
+
+    genmidi_key = fnv1a(0xcbf29ce484222325ull, MUSIC_CACHE_MAGIC, 8);
+    genmidi_key = fnv1a(genmidi_key, genmidi, W_LumpLength(lump));
+    genmidi = (const struct GenmidiInstr *)((const byte *)genmidi + 8);
+
+    synth_init_tables();
+
+    music_sema = sceKernelCreateSema("cq_music", 0, 0, 1024, NULL);
+    stream_lock = sceKernelCreateSema("cq_music_stream", 0, 1, 1, NULL);
+    if (music_sema < 0 || stream_lock < 0)
+        return false;
+
+    // Sul core 1 sotto la priorita' del gioco: il rendering dei brani e'
+    // lavoro di sfondo, e i buffer durano piu' di un secondo
+    music_running = 1;
+    music_thread = sceKernelCreateThread("cq_music", music_thread_main, 0x10000100 + 16,
+                                         0x10000, 0, SCE_KERNEL_CPU_MASK_USER_1, NULL);
+    if (music_thread < 0 || sceKernelStartThread(music_thread, 0, NULL) < 0) {
+        music_running = 0;
+        return false;
+    }
+
+    music_ready = 1;
+    return true;
+}
+
+static void I_Vita_ShutdownMusic(void) {
+    if (!music_ready)
+        return;
+
+    music_ready = 0;
+    music_running = 0;
+    sceKernelSignalSema(music_sema, 1);
+    sceKernelWaitThreadEnd(music_thread, NULL, NULL);
+    music_thread = -1;
+}
+
+// volume 0..127
+static void I_Vita_SetMusicVolume(int volume) {
+    __atomic_store_n(&music_gain, volume * 2, __ATOMIC_RELAXED);
+}
+
+static void I_Vita_PauseMusic(void) {
+    __atomic_store_n(&music_paused, 1, __ATOMIC_RELAXED);
+}
+
+static void I_Vita_ResumeMusic(void) {
+    __atomic_store_n(&music_paused, 0, __ATOMIC_RELAXED);
+}
+
+static void *I_Vita_RegisterSong(void *data, int len) {
+    struct MusicCmd cmd = { .type = MUSIC_CMD_REGISTER };
+    struct MusicSong *song;
+
+    if (!music_ready || len <= 0)
+        return NULL;
+
+    // Il thread lavora su una copia: il lump puo' sparire prima che abbia finito
+    song = calloc(1, sizeof(*song));
+    if (!song)
+        return NULL;
+
+    song->data = malloc(len);
+    if (!song->data) {
+        free(song);
+        return NULL;
+    }
+    memcpy(song->data, data, len);
+    song->len = len;
+    song->state = SONG_PENDING;
+
+    cmd.song = song;
+    push_command(&cmd);
+    return song;
+}
+
+static void I_Vita_UnRegisterSong(void *handle) {
+    struct MusicCmd cmd = { .type = MUSIC_CMD_UNREGISTER, .song = handle };
+
+    if (!music_ready || !handle)
+        return;
+
+    push_command(&cmd);
+}
+
+static void I_Vita_PlaySong(void *handle, boolean looping) {
+    struct MusicCmd cmd = { .type = MUSIC_CMD_PLAY, .song = handle, .looping = looping };
+
+    if (!music_ready || !handle)
+        return;
+
+    cmd.seq = ++play_seq;
+    song_playing = 1;
+    push_command(&cmd);
+}
+
+static void I_Vita_StopSong(void) {
+    struct MusicCmd cmd = { .type = MUSIC_CMD_STOP };
+
+    if (!music_ready)
+        return;
+
+    song_playing = 0;
+    push_command(&cmd);
+}
+
+static boolean I_Vita_MusicIsPlaying(void) {
+    return song_playing && __atomic_load_n(&ended_seq, __ATOMIC_ACQUIRE) != play_seq;
+}
+
+static void I_Vita_PollMusic(void) {
+    // Tutto il lavoro e' sul thread della musica e sul mixer
+}
+
+music_module_t DG_music_module = {
+    music_devices,
+    sizeof(music_devices) / sizeof(*music_devices),
+    I_Vita_InitMusic,
+    I_Vita_ShutdownMusic,
+    I_Vita_SetMusicVolume,
+    I_Vita_PauseMusic,
+    I_Vita_ResumeMusic,
+    I_Vita_RegisterSong,
+    I_Vita_UnRegisterSong,
+    I_Vita_PlaySong,
+    I_Vita_StopSong,
+    I_Vita_MusicIsPlaying,
+    I_Vita_PollMusic,
+};
@@ -0,0 +1,16 @@
+#ifndef VITA_MUSIC_H
+#define VITA_MUSIC_H
+
+#include <stdint.h>
+
+// Musica pre-renderizzata: ogni brano MUS viene sintetizzato una volta (FM
+// a due operatori con le patch di GENMIDI) da un thread in background e
+// salvato in ux0:data/ChexQuest/cache come IMA ADPCM. Durante il gioco lo
+// stesso thread lo legge a blocchi in due buffer alternati e il mixer di
+// vita_audio.c lo decodifica: il loop del gioco non fa nulla.
+
+// Dal thread di mixaggio: aggiunge count campioni a 48 kHz (Q8, come i
+// canali degli effetti) agli accumulatori
+void vita_music_mix(int32_t *mix_l, int32_t *mix_r, int count);
+
+#endif
@@ -0,0 +1,162 @@
+#include "doomgeneric.h"
+#include "doomstat.h"
+#include <psp2/kernel/processmgr.h>
+#include <psp2/power.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
+
+#ifdef VITA_INTERPOLATION
+#include "vita_interp.h"
+#endif
+#include "vita_config.h"
+#include "vita_power.h"
+#include "vita_prof.h"
+
+// Frame per misura: circa un secondo a 60 Hz
+#define POWER_WINDOW 64
+
+// Tutti i frame devono stare in un vblank, anche a 35 fps: con il vsync un
+// tic su tre ne ha uno solo
+#define POWER_BUDGET_US 16683
+
+// Si sale se il 90-esimo percentile supera l'85% del budget; si scende se,
+// riscalato sul clock inferiore, resta sotto il 60% per POWER_DOWN_WINDOWS
+// misure di fila (solo in livello: menu e intermissioni non contano)
+#define POWER_UP_PERCENT 85
+#define POWER_DOWN_PERCENT 60
+#define POWER_DOWN_WINDOWS 8
+
+struct ClockProfile {
+    const char *name;
+    int arm, bus, gpu, xbar;    // MHz
+};
+
+static const struct ClockProfile profiles[POWER_NUM_PROFILES] = {
+    { "save",   222, 166, 111, 111 },
+    { "normal", 333, 222, 111, 111 },
+    { "high",   444, 222, 222, 166 },
+};
+
+static int auto_mode = 1;
+static enum PowerProfile current = POWER_NORMAL;
+
+#ifdef VITA_PROFILER
+static uint32_t window_start = 0;
+static int down_windows = 0;
+#endif
+
+static void apply_profile(enum PowerProfile profile) {
+    const struct ClockProfile *p = &profiles[profile];
+
+    scePowerSetArmClockFrequency(p->arm);
+    scePowerSetBusClockFrequency(p->bus);
+    scePowerSetGpuClockFrequency(p->gpu);
+    scePowerSetGpuXbarClockFrequency(p->xbar);
+    current = profile;
+}
+
+static enum PowerProfile parse_profile(const char *name) {
+    for (int i = 0; i < POWER_NUM_PROFILES; i++)
+        if (!strcasecmp(name, profiles[i].name))
+            return i;
+
+    return POWER_NUM_PROFILES;
+}
+
+void vita_power_init(void) {
+    enum PowerProfile profile = POWER_SAVE;
+
+    if (DOOMGENERIC_RESX > 320)
+        profile = POWER_HIGH;
+#ifdef VITA_INTERPOLATION
+    if (vita_interp_enabled)
+        profile = POWER_HIGH;
+#endif
+
+    if (strcasecmp(vita_config.clock, "auto")) {
+        enum PowerProfile fixed = parse_profile(vita_config.clock);
+
+        if (fixed < POWER_NUM_PROFILES) {
+            profile = fixed;
+            auto_mode = 0;
+        }
+    }
+
+#ifndef VITA_PROFILER
+    // Senza misure il profilo iniziale resta quello
+    auto_mode = 0;
+#endif
+
+    apply_profile(profile);
+}
+
+#ifdef VITA_PROFILER
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+static void adjust_profile(void) {
+    static uint32_t busy[POWER_WINDOW];
+    int count = vita_prof_busy_times(busy, POWER_WINDOW);
+    uint32_t p90;
+
+    if (count < POWER_WINDOW)
+        return;
+
+    qsort(busy, count, sizeof(busy[0]), compare_u32);
+    p90 = busy[count * 9 / 10];
+
+    if (p90 > POWER_BUDGET_US * POWER_UP_PERCENT / 100) {
+        down_windows = 0;
+        if (current < POWER_HIGH)
+            apply_profile(current + 1);
+        return;
+    }
+
+    // Il lavoro del frame e' quasi tutto CPU: scala con il clock ARM
+    if (current > POWER_SAVE && gamestate == GS_LEVEL &&
+        (uint64_t)p90 * profiles[current].arm / profiles[current - 1].arm <
+            POWER_BUDGET_US * POWER_DOWN_PERCENT / 100) {
+        if (++down_windows >= POWER_DOWN_WINDOWS) {
+            down_windows = 0;
+            apply_profile(current - 1);
+        }
+    } else {
+        down_windows = 0;
+    }
+}
+#endif
+
+void vita_power_tick(void) {
+#ifdef VITA_PROFILER
+    uint32_t frames = vita_prof_frames();
+
+    if (frames - window_start < POWER_WINDOW)
+        return;
+    window_start = frames;
+
+    if (auto_mode)
+        adjust_profile();
+#else
+    static uint32_t last_check = 0;
+    uint32_t now = sceKernelGetProcessTimeLow();
+
+    if (now - last_check < 1000000)
+        return;
+    last_check = now;
+#endif
+
+    // Dopo una sospensione il sistema torna ai clock predefiniti
+    if (scePowerGetArmClockFrequency() != profiles[current].arm)
+        apply_profile(current);
+}
+
+void vita_power_describe(char *buf, size_t len) {
+    const struct ClockProfile *p = &profiles[current];
+
+    snprintf(buf, len, "%s%s %d/%d/%d MHz", p->name, auto_mode ? " (auto)" : "",
+             p->arm, p->bus, p->gpu);
+}
@@ -0,0 +1,27 @@
+#ifndef VITA_POWER_H
+#define VITA_POWER_H
+
+#include <stddef.h>
+
+// Profili di clock di CPU, bus e GPU (-clock auto|save|normal|high). In
+// automatico si parte da high con la risoluzione alta o -interpolate e da
+// save altrimenti, poi il margine misurato dal profilo dei frame sposta il
+// profilo di un passo alla volta.
+
+enum PowerProfile {
+    POWER_SAVE,         // 222 MHz: i 35 fps originali con margine
+    POWER_NORMAL,       // 333 MHz, il clock predefinito del sistema
+    POWER_HIGH,         // 444 MHz, GPU e crossbar al massimo
+    POWER_NUM_PROFILES
+};
+
+// Da DG_Init, dopo vita_interp_init
+void vita_power_init(void);
+
+// Una volta per giro del loop principale
+void vita_power_tick(void);
+
+// Profilo e clock correnti, per l'overlay
+void vita_power_describe(char *buf, size_t len);
+
+#endif
@@ -0,0 +1,189 @@
+#include "doomgeneric.h"
+#include "doomdata.h"
+#include "doomstat.h"
+#include "i_swap.h"
+#include "m_argv.h"
+#include "r_data.h"
+#include "w_wad.h"
+#include "z_zone.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vita_prefetch.h"
+
+#define LOAD_LOG_PATH "ux0:data/ChexQuest/load.log"
+
+// Tempo massimo per giro del loop speso a preparare il livello: l'animazione
+// dell'intermissione deve restare fluida.
+#define PREFETCH_BUDGET_MS 4
+
+// Texture e flat del livello successivo ancora da preparare. Le texture
+// sono indici in textures[], i flat numeri di lump.
+#define PREFETCH_MAX_ITEMS 1024
+
+enum PrefetchState {
+    PREFETCH_IDLE,      // in attesa della prossima intermissione
+    PREFETCH_WARMING,   // lista pronta, preparazione in corso
+    PREFETCH_DONE,      // finito (o niente da fare) per questa intermissione
+};
+
+struct PrefetchItem {
+    int texture;        // -1 per i flat
+    int lump;
+};
+
+static int prefetch_enabled = 1;
+static enum PrefetchState state = PREFETCH_IDLE;
+static struct PrefetchItem items[PREFETCH_MAX_ITEMS];
+static int num_items = 0;
+static int next_item = 0;
+
+// Misura del caricamento: da P_SetupLevel al primo frame disegnato
+static int load_pending = 0;
+static int load_prefetched = 0;
+static uint32_t load_start_ms = 0;
+static char load_name[9];
+
+static void map_lump_name(char *name, int episode, int map) {
+    if (gamemode == commercial)
+        snprintf(name, 9, "MAP%02d", map);
+    else
+        snprintf(name, 9, "E%dM%d", episode, map);
+}
+
+static void add_item(int texture, int lump) {
+    for (int i = 0; i < num_items; i++)
+        if (items[i].texture == texture && items[i].lump == lump)
+            return;
+
+    if (num_items < PREFETCH_MAX_ITEMS) {
+        items[num_items].texture = texture;
+        items[num_items].lump = lump;
+        num_items++;
+    }
+}
+
+static void add_texture(const char *name8) {
+    char name[9];
+
+    memcpy(name, name8, 8);
+    name[8] = '\0';
+
+    int tex = R_CheckTextureNumForName(name);
+    if (tex > 0)
+        add_item(tex, -1);
+}
+
+static void add_flat(const char *name8) {
+    char name[9];
+
+    memcpy(name, name8, 8);
+    name[8] = '\0';
+
+    int lump = W_CheckNumForName(name);
+    if (lump >= 0)
+        add_item(-1, lump);
+}
+
+// Legge SIDEDEFS e SECTORS del livello che seguira' l'intermissione
+static void collect_next_level(void) {
+    char name[9];
+
+    num_items = 0;
+    next_item = 0;
+
+    map_lump_name(name, wminfo.epsd + 1, wminfo.next + 1);
+    int maplump = W_CheckNumForName(name);
+    if (maplump < 0)
+        return;
+
+    int lump = maplump + ML_SIDEDEFS;
+    const mapsidedef_t *sides = W_CacheLumpNum(lump, PU_STATIC);
+    int numsides = W_LumpLength(lump) / sizeof(mapsidedef_t);
+
+    for (int i = 0; i < numsides; i++) {
+        add_texture(sides[i].toptexture);
+        add_texture(sides[i].midtexture);
+        add_texture(sides[i].bottomtexture);
+    }
+    W_ReleaseLumpNum(lump);
+
+    lump = maplump + ML_SECTORS;
+    const mapsector_t *sectors = W_CacheLumpNum(lump, PU_STATIC);
+    int numsectors = W_LumpLength(lump) / sizeof(mapsector_t);
+
+    for (int i = 0; i < numsectors; i++) {
+        add_flat(sectors[i].floorpic);
+        add_flat(sectors[i].ceilingpic);
+    }
+    W_ReleaseLumpNum(lump);
+}
+
+// La zona non e' thread-safe: la preparazione avviene sul thread di gioco,
+// poche voci per giro, finche' resta budget.
+static void warm_items(void) {
+    uint32_t start = DG_GetTicksMs();
+
+    while (next_item < num_items) {
+        const struct PrefetchItem *item = &items[next_item++];
+
+        if (item->texture >= 0)
+            R_WarmTexture(item->texture);
+        else
+            W_CacheLumpNum(item->lump, PU_CACHE);
+
+        if (DG_GetTicksMs() - start >= PREFETCH_BUDGET_MS)
+            return;
+    }
+
+    state = PREFETCH_DONE;
+}
+
+static void log_level_load(void) {
+    uint32_t elapsed = DG_GetTicksMs() - load_start_ms;
+
+    printf("Level %s loaded in %u ms (prefetch %s)\n", load_name,
+           (unsigned)elapsed, load_prefetched ? "on" : "off");
+
+    FILE *f = fopen(LOAD_LOG_PATH, "a");
+    if (f) {
+        fprintf(f, "%s %u ms prefetch=%s\n", load_name, (unsigned)elapsed,
+                load_prefetched ? "on" : "off");
+        fclose(f);
+    }
+}
+
+void vita_prefetch_init(void) {
+    prefetch_enabled = !M_CheckParm("-noprefetch");
+}
+
+void vita_prefetch_tick(void) {
+    // P_SetupLevel e il primo frame del livello sono gia' passati
+    if (load_pending && gamestate == GS_LEVEL) {
+        log_level_load();
+        load_pending = 0;
+    }
+
+    if (gamestate != GS_INTERMISSION) {
+        state = PREFETCH_IDLE;
+        return;
+    }
+
+    if (!prefetch_enabled || state == PREFETCH_DONE)
+        return;
+
+    if (state == PREFETCH_IDLE) {
+        collect_next_level();
+        state = PREFETCH_WARMING;
+    }
+
+    warm_items();
+}
+
+void vita_prefetch_level_start(int episode, int map) {
+    map_lump_name(load_name, episode, map);
+    load_prefetched = prefetch_enabled && state == PREFETCH_DONE;
+    load_start_ms = DG_GetTicksMs();
+    load_pending = 1;
+}
@@ -0,0 +1,19 @@
+#ifndef VITA_PREFETCH_H
+#define VITA_PREFETCH_H
+
+// Preparazione del livello successivo durante l'intermissione (-noprefetch
+// la disattiva) e misura del tempo di caricamento dei livelli.
+
+void vita_prefetch_init(void);
+
+// Una volta per giro del loop principale, dopo doomgeneric_Tick
+void vita_prefetch_tick(void);
+
+// Da P_SetupLevel (engine/p_setup_vita.c), prima del caricamento
+void vita_prefetch_level_start(int episode, int map);
+
+// Compone la texture (se a piu' patch) e ne carica le patch
+// (engine/r_data_vita.c)
+void R_WarmTexture(int texnum);
+
+#endif
@@ -0,0 +1,212 @@
+#include "m_argv.h"
+#include <psp2/kernel/processmgr.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vita2d.h>
+
+#include "vita_input.h"
+#ifdef VITA_POWER
+#include "vita_power.h"
+#endif
+#include "vita_prof.h"
+
+// Frame tenuti per le statistiche (potenza di due)
+#define PROF_RING_SIZE 256
+#define PROF_RING_MASK (PROF_RING_SIZE - 1)
+
+// Ogni quanti frame ricalcolare le statistiche dell'overlay
+#define PROF_STATS_PERIOD 30
+
+// Durata di un frame a 60 Hz: e' la scala delle barre
+#define PROF_FRAME_BUDGET_US 16667
+#define PROF_BAR_WIDTH 200
+
+struct ProfFrame {
+    uint32_t stage_us[PROF_NUM_STAGES];
+    uint32_t frame_us;
+};
+
+static const char *const stage_names[PROF_NUM_STAGES] = {
+    "pad", "ticker", "render", "convert", "draw", "swap",
+};
+
+static const unsigned int stage_colors[PROF_NUM_STAGES] = {
+    RGBA8(0x80, 0x80, 0xff, 0xff),
+    RGBA8(0x40, 0xd0, 0x40, 0xff),
+    RGBA8(0xff, 0xa0, 0x20, 0xff),
+    RGBA8(0xff, 0x40, 0x40, 0xff),
+    RGBA8(0xc0, 0x60, 0xff, 0xff),
+    RGBA8(0x60, 0x60, 0x60, 0xff),
+};
+
+int vita_prof_overlay = 0;
+
+// Accumulatori del frame in corso, svuotati a ogni vita_prof_end_frame
+static uint32_t stage_acc[PROF_NUM_STAGES];
+
+static struct ProfFrame ring[PROF_RING_SIZE];
+static uint32_t ring_head = 0;          // frame scritti in totale
+static uint32_t last_frame_end = 0;
+
+// Statistiche mostrate dall'overlay
+static float stat_fps = 0;
+static float stat_low_fps = 0;
+static uint32_t stat_stage_us[PROF_NUM_STAGES];
+static uint32_t stat_other_us = 0;
+static struct InputStats stat_input;
+
+static vita2d_pgf *font = NULL;
+
+void vita_prof_init(void) {
+    vita_prof_overlay = M_CheckParm("-perfoverlay") > 0;
+    last_frame_end = vita_prof_now();
+}
+
+uint32_t vita_prof_now(void) {
+    return sceKernelGetProcessTimeLow();
+}
+
+void vita_prof_add(enum ProfStage stage, uint32_t start) {
+    __atomic_fetch_add(&stage_acc[stage], vita_prof_now() - start, __ATOMIC_RELAXED);
+}
+
+void vita_prof_end_frame(void) {
+    uint32_t head = ring_head;
+    struct ProfFrame *f = &ring[head & PROF_RING_MASK];
+    uint32_t now = vita_prof_now();
+
+    for (int i = 0; i < PROF_NUM_STAGES; i++)
+        f->stage_us[i] = __atomic_exchange_n(&stage_acc[i], 0, __ATOMIC_RELAXED);
+
+    f->frame_us = now - last_frame_end;
+    last_frame_end = now;
+
+    __atomic_store_n(&ring_head, head + 1, __ATOMIC_RELEASE);
+}
+
+void vita_prof_toggle_overlay(void) {
+    vita_prof_overlay = !vita_prof_overlay;
+}
+
+uint32_t vita_prof_frames(void) {
+    return __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE);
+}
+
+int vita_prof_busy_times(uint32_t *busy_us, int max) {
+    uint32_t head = __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE);
+    int count = head < PROF_RING_SIZE ? head : PROF_RING_SIZE;
+
+    if (count > max)
+        count = max;
+
+    for (int i = 0; i < count; i++) {
+        const struct ProfFrame *f = &ring[(head - 1 - i) & PROF_RING_MASK];
+        uint32_t busy = 0;
+
+        for (int s = 0; s < PROF_NUM_STAGES; s++)
+            if (s != PROF_SWAP)
+                busy += f->stage_us[s];
+        busy_us[i] = busy;
+    }
+
+    return count;
+}
+
+static int compare_desc(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+static void update_stats(void) {
+    static uint32_t sorted[PROF_RING_SIZE];
+    uint32_t head = __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE);
+    uint32_t count = head < PROF_RING_SIZE ? head : PROF_RING_SIZE;
+    uint64_t total = 0;
+    uint64_t stages[PROF_NUM_STAGES] = { 0 };
+    uint64_t stage_sum = 0;
+
+    if (count == 0)
+        return;
+
+    for (uint32_t i = 0; i < count; i++) {
+        const struct ProfFrame *f = &ring[(head - 1 - i) & PROF_RING_MASK];
+
+        sorted[i] = f->frame_us;
+        total += f->frame_us;
+        for (int s = 0; s < PROF_NUM_STAGES; s++)
+            stages[s] += f->stage_us[s];
+    }
+
+    // 1% low: l'FPS del frame al 99-esimo percentile di durata
+    qsort(sorted, count, sizeof(sorted[0]), compare_desc);
+    uint32_t worst = sorted[count / 100];
+
+    stat_fps = total ? 1e6f * count / total : 0;
+    stat_low_fps = worst ? 1e6f / worst : 0;
+
+    for (int s = 0; s < PROF_NUM_STAGES; s++) {
+        stat_stage_us[s] = stages[s] / count;
+        stage_sum += stat_stage_us[s];
+    }
+    stat_other_us = total / count > stage_sum ? total / count - stage_sum : 0;
+
+    vita_input_take_stats(&stat_input);
+}
+
+static void draw_bar(int y, const char *name, uint32_t us, unsigned int color) {
+    int w = us * PROF_BAR_WIDTH / PROF_FRAME_BUDGET_US;
+
+    if (w > PROF_BAR_WIDTH * 2)
+        w = PROF_BAR_WIDTH * 2;
+
+    vita2d_pgf_draw_textf(font, 12, y + 12, RGBA8(0xff, 0xff, 0xff, 0xff), 0.7f,
+                          "%-8s %5.2f", name, us / 1000.0f);
+    vita2d_draw_rectangle(120, y + 2, w, 10, color);
+}
+
+void vita_prof_draw_overlay(void) {
+    if (!vita_prof_overlay)
+        return;
+
+    if (!font)
+        font = vita2d_load_default_pgf();
+    if (!font)
+        return;
+
+    if ((ring_head % PROF_STATS_PERIOD) == 0)
+        update_stats();
+
+    int rows = PROF_NUM_STAGES + 1;
+    int lines = rows + 1;
+#ifdef VITA_POWER
+    lines++;
+#endif
+    vita2d_draw_rectangle(6, 6, 120 + PROF_BAR_WIDTH * 2 + 8, 30 + lines * 16,
+                          RGBA8(0, 0, 0, 0xa0));
+
+    vita2d_pgf_draw_textf(font, 12, 24, RGBA8(0xff, 0xff, 0x60, 0xff), 0.8f,
+                          "FPS %.1f   1%% low %.1f", stat_fps, stat_low_fps);
+
+    // Tacca al budget di 16.7 ms
+    vita2d_draw_rectangle(120 + PROF_BAR_WIDTH, 30, 1, rows * 16, RGBA8(0xff, 0xff, 0xff, 0x80));
+
+    for (int s = 0; s < PROF_NUM_STAGES; s++)
+        draw_bar(30 + s * 16, stage_names[s], stat_stage_us[s], stage_colors[s]);
+
+    draw_bar(30 + PROF_NUM_STAGES * 16, "other", stat_other_us, RGBA8(0x30, 0x30, 0x30, 0xff));
+
+    // Latenza dal campione del pad a DG_GetKey, sugli eventi del periodo
+    vita2d_pgf_draw_textf(font, 12, 30 + rows * 16 + 12, RGBA8(0xff, 0xff, 0xff, 0xff), 0.7f,
+                          "input    %5.2f ms  max %5.2f  drop %u",
+                          stat_input.events ? stat_input.latency_sum_us / 1000.0f / stat_input.events : 0.0f,
+                          stat_input.latency_max_us / 1000.0f, (unsigned)stat_input.dropped);
+
+#ifdef VITA_POWER
+    char clock[48];
+
+    vita_power_describe(clock, sizeof(clock));
+    vita2d_pgf_draw_textf(font, 12, 30 + (rows + 1) * 16 + 12, RGBA8(0xff, 0xff, 0xff, 0xff), 0.7f,
+                          "clock    %s", clock);
+#endif
+}
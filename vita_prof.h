@@ -0,0 +1,57 @@
+#ifndef VITA_PROF_H
+#define VITA_PROF_H
+
+#include <stdint.h>
+
+// Profilo dei frame: tempi per fase, un record per frame presentato in un
+// anello senza lock. L'overlay (SELECT+L) mostra FPS, 1% low e una barra
+// per fase.
+
+enum ProfStage {
+    PROF_PAD,           // lettura del pad e coda eventi
+    PROF_TICKER,        // G_Ticker
+    PROF_RENDER,        // R_RenderPlayerView
+    PROF_CONVERT,       // conversione/copia dei pixel nella texture
+    PROF_DRAW,          // comandi vita2d del frame (overlay compreso)
+    PROF_SWAP,          // attesa del vblank/GPU e swap
+    PROF_NUM_STAGES
+};
+
+#ifdef VITA_PROFILER
+
+extern int vita_prof_overlay;
+
+void vita_prof_init(void);
+
+// Microsecondi, per misurare una fase
+uint32_t vita_prof_now(void);
+
+// Aggiunge now - start alla fase; chiamabile da qualunque thread
+void vita_prof_add(enum ProfStage stage, uint32_t start);
+
+// Dal thread che presenta, dopo lo swap: chiude il record del frame
+void vita_prof_end_frame(void);
+
+void vita_prof_toggle_overlay(void);
+
+// Frame chiusi in totale, per sapere quanti ne sono arrivati da una lettura
+uint32_t vita_prof_frames(void);
+
+// Tempo di lavoro (tutte le fasi tranne lo swap) degli ultimi max frame al
+// massimo, dal piu' recente; ritorna quanti ne ha scritti
+int vita_prof_busy_times(uint32_t *busy_us, int max);
+
+// Dentro vita2d_start_drawing/end_drawing, sopra il frame
+void vita_prof_draw_overlay(void);
+
+#define PROF_BEGIN(var) uint32_t var = vita_prof_now()
+#define PROF_END(stage, var) vita_prof_add((stage), (var))
+
+#else
+
+#define PROF_BEGIN(var) do { } while (0)
+#define PROF_END(stage, var) do { } while (0)
+
+#endif
+
+#endif
@@ -0,0 +1,219 @@
+#include "doomgeneric.h"
+#include "i_video.h"
+#include <psp2/kernel/threadmgr.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "vita_config.h"
+#include "vita_rthreads.h"
+
+// Worker disponibili: i core utente 1 e 2 (il gioco resta sul core 0)
+#define RTHREADS_MAX 2
+
+// Comandi per coda (potenza di due). Se un worker resta indietro il
+// thread di gioco aspetta che si liberi spazio.
+#define RTHREADS_QUEUE_SIZE 4096
+#define RTHREADS_QUEUE_MASK (RTHREADS_QUEUE_SIZE - 1)
+
+// Comandi accumulati prima di pubblicarli al worker
+#define RTHREADS_BATCH 16
+
+// Giri a vuoto prima che un worker senza lavoro ceda il core
+#define RTHREADS_SPIN 256
+
+#if defined(__arm__)
+#define cpu_relax() __asm__ volatile("yield")
+#else
+#define cpu_relax() do { } while (0)
+#endif
+
+// Coda a produttore singolo (thread di gioco) e consumatore singolo
+struct RWorker {
+    struct DrawCmd cmds[RTHREADS_QUEUE_SIZE];
+    uint32_t head;              // scritto dal gioco, letto dal worker
+    uint32_t tail;              // scritto dal worker, letto dal gioco
+    uint32_t local_head;        // comandi scritti ma non ancora pubblicati
+    int closed;                 // il frame e' finito: svuota la coda ed esci
+    SceUID start_sema;
+    SceUID done_sema;
+};
+
+int vita_rthreads_active = 0;
+
+static struct RWorker *workers = NULL;
+static int num_workers = 0;
+
+// Worker proprietario di ogni colonna della vista, e bordi delle strisce
+static unsigned char strip_of[SCREENWIDTH];
+static int strip_start[RTHREADS_MAX + 1];
+static int strip_width = -1;
+
+static void setup_strips(int viewwidth) {
+    if (viewwidth == strip_width)
+        return;
+
+    for (int w = 0; w <= num_workers; w++)
+        strip_start[w] = viewwidth * w / num_workers;
+
+    for (int w = 0; w < num_workers; w++)
+        for (int x = strip_start[w]; x < strip_start[w + 1]; x++)
+            strip_of[x] = w;
+
+    strip_width = viewwidth;
+}
+
+static void publish(struct RWorker *w) {
+    __atomic_store_n(&w->head, w->local_head, __ATOMIC_RELEASE);
+}
+
+static void push(struct RWorker *w, const struct DrawCmd *cmd) {
+    while (w->local_head - __atomic_load_n(&w->tail, __ATOMIC_ACQUIRE) >= RTHREADS_QUEUE_SIZE) {
+        publish(w);
+        cpu_relax();
+    }
+
+    w->cmds[w->local_head & RTHREADS_QUEUE_MASK] = *cmd;
+    w->local_head++;
+
+    if ((w->local_head & (RTHREADS_BATCH - 1)) == 0)
+        publish(w);
+}
+
+static int worker_main(SceSize args, void *argp) {
+    struct RWorker *w = &workers[*(int *)argp];
+
+    for (;;) {
+        sceKernelWaitSema(w->start_sema, 1, NULL);
+
+        int spins = 0;
+        for (;;) {
+            uint32_t tail = w->tail;
+
+            if (tail == __atomic_load_n(&w->head, __ATOMIC_ACQUIRE)) {
+                // Chiusura vista solo dopo aver letto head: ricontrolla
+                if (__atomic_load_n(&w->closed, __ATOMIC_ACQUIRE) &&
+                    tail == __atomic_load_n(&w->head, __ATOMIC_ACQUIRE))
+                    break;
+
+                if (++spins < RTHREADS_SPIN) {
+                    cpu_relax();
+                } else {
+                    sceKernelDelayThread(20);
+                    spins = 0;
+                }
+                continue;
+            }
+
+            R_ExecDrawCmd(&w->cmds[tail & RTHREADS_QUEUE_MASK]);
+            __atomic_store_n(&w->tail, tail + 1, __ATOMIC_RELEASE);
+            spins = 0;
+        }
+
+        sceKernelSignalSema(w->done_sema, 1);
+    }
+
+    return 0;
+}
+
+void vita_rthreads_init(void) {
+    static const int cpu_masks[RTHREADS_MAX] = {
+        SCE_KERNEL_CPU_MASK_USER_1, SCE_KERNEL_CPU_MASK_USER_2
+    };
+    int n = vita_config.rthreads < 0 ? RTHREADS_MAX : vita_config.rthreads;
+
+    if (n <= 0)
+        return;
+    if (n > RTHREADS_MAX)
+        n = RTHREADS_MAX;
+
+    workers = calloc(n, sizeof(*workers));
+    if (!workers)
+        return;
+
+    sceKernelChangeThreadCpuAffinityMask(sceKernelGetThreadId(), SCE_KERNEL_CPU_MASK_USER_0);
+
+    for (int i = 0; i < n; i++) {
+        struct RWorker *w = &workers[i];
+
+        w->start_sema = sceKernelCreateSema("cq_rstart", 0, 0, 1, NULL);
+        w->done_sema = sceKernelCreateSema("cq_rdone", 0, 0, 1, NULL);
+
+        SceUID thid = sceKernelCreateThread("cq_rworker", worker_main, 0x10000100,
+                                            0x4000, 0, cpu_masks[i], NULL);
+        if (thid < 0)
+            break;
+
+        sceKernelStartThread(thid, sizeof(i), &i);
+        num_workers++;
+    }
+}
+
+int vita_rthreads_begin(int viewwidth) {
+    if (num_workers == 0 || viewwidth <= 0 || viewwidth > SCREENWIDTH)
+        return 0;
+
+    setup_strips(viewwidth);
+
+    for (int i = 0; i < num_workers; i++) {
+        __atomic_store_n(&workers[i].closed, 0, __ATOMIC_RELAXED);
+        sceKernelSignalSema(workers[i].start_sema, 1);
+    }
+
+    vita_rthreads_active = 1;
+    return 1;
+}
+
+void vita_rthreads_end(void) {
+    vita_rthreads_active = 0;
+
+    for (int i = 0; i < num_workers; i++) {
+        publish(&workers[i]);
+        __atomic_store_n(&workers[i].closed, 1, __ATOMIC_RELEASE);
+    }
+
+    // Barriera: il frame deve essere completo prima di HUD e DG_DrawFrame
+    for (int i = 0; i < num_workers; i++)
+        sceKernelWaitSema(workers[i].done_sema, 1, NULL);
+}
+
+void vita_rthreads_flush(void) {
+    for (int i = 0; i < num_workers; i++) {
+        struct RWorker *w = &workers[i];
+
+        publish(w);
+        while (__atomic_load_n(&w->tail, __ATOMIC_ACQUIRE) != w->local_head)
+            cpu_relax();
+    }
+}
+
+void vita_rthreads_column(int x, const struct DrawCmd *cmd) {
+    push(&workers[strip_of[x]], cmd);
+}
+
+void vita_rthreads_span(int x1, const struct DrawCmd *cmd) {
+    struct DrawCmd part = *cmd;
+    int x = x1;
+    int x2 = x1 + cmd->count - 1;
+    int w = strip_of[x1];
+
+    if (cmd->count <= 0)
+        return;
+
+    for (;;) {
+        int end = strip_start[w + 1] - 1;
+
+        if (x2 <= end) {
+            part.count = x2 - x + 1;
+            push(&workers[w], &part);
+            return;
+        }
+
+        part.count = end - x + 1;
+        push(&workers[w], &part);
+
+        part.dest += part.count;
+        part.frac = (fixed_t)((unsigned int)part.frac + (unsigned int)part.step * part.count);
+        x = end + 1;
+        w++;
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef VITA_RTHREADS_H
+#define VITA_RTHREADS_H
+
+#include "doomtype.h"
+#include "m_fixed.h"
+
+// Rendering multi-core (-rthreads 0|1|2): il thread di gioco percorre il BSP
+// e registra i comandi di disegno, i worker sui core 1 e 2 li eseguono,
+// ognuno su una striscia verticale dello schermo.
+
+enum DrawCmdKind {
+    DRAWCMD_COLUMN,
+    DRAWCMD_TRANSLATED,
+    DRAWCMD_FUZZ,
+    DRAWCMD_SPAN,
+};
+
+// Un drawer con lo stato dc_*/ds_* gia' risolto al momento della chiamata
+struct DrawCmd {
+    int kind;
+    byte *dest;
+    int count;
+    fixed_t frac;               // span: posizione impacchettata
+    fixed_t step;
+    const byte *source;
+    const byte *colormap;
+    const byte *translation;
+    int fuzzpos;                // fuzz: indice iniziale in fuzzoffset
+};
+
+// Non zero mentre i drawer di r_draw_vita.c vanno accodati
+extern int vita_rthreads_active;
+
+void vita_rthreads_init(void);
+
+// Attorno a R_RenderPlayerView (engine/r_main_vita.c). begin ritorna zero se
+// il frame va disegnato sul thread di gioco; end aspetta tutti i worker.
+int vita_rthreads_begin(int viewwidth);
+void vita_rthreads_end(void);
+
+// Aspetta che i worker abbiano eseguito tutti i comandi accodati, senza
+// chiudere il frame: i comandi puntano a compositi PU_CACHE che la zona
+// deve poter eliminare (engine/z_zone_vita.c)
+void vita_rthreads_flush(void);
+
+// Accodamento dal thread di gioco: le colonne vanno al worker che possiede
+// x, gli span vengono spezzati sui bordi delle strisce.
+void vita_rthreads_column(int x, const struct DrawCmd *cmd);
+void vita_rthreads_span(int x1, const struct DrawCmd *cmd);
+
+// Esecuzione di un comando (engine/r_draw_vita.c)
+void R_ExecDrawCmd(const struct DrawCmd *cmd);
+
+#endif
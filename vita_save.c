@@ -0,0 +1,322 @@
+#include "i_system.h"
+#include <psp2/io/fcntl.h>
+#include <psp2/io/stat.h>
+#include <psp2/kernel/threadmgr.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vita_save.h"
+
+// Copie tenute in RAM (il salvataggio rapido e gli ultimi slot usati)
+#define SAVE_CACHE_SLOTS 4
+
+// Scritture in coda (potenza di due)
+#define SAVE_QUEUE_SIZE 8
+#define SAVE_QUEUE_MASK (SAVE_QUEUE_SIZE - 1)
+
+#define SAVE_PATH_MAX 256
+
+// Attesa massima delle scritture in coda all'uscita
+#define SAVE_FLUSH_TIMEOUT_MS 3000
+
+// Immagine di un salvataggio; non cambia piu' dopo la creazione e si
+// libera quando nessuno (cache, coda, letture aperte) la usa
+struct SaveSnapshot {
+    int refs;
+    size_t size;
+    char *data;
+};
+
+struct SaveCacheEntry {
+    char path[SAVE_PATH_MAX];
+    struct SaveSnapshot *snap;
+    uint32_t last_use;
+};
+
+struct SaveJob {
+    char path[SAVE_PATH_MAX];
+    struct SaveSnapshot *snap;
+};
+
+struct SaveReader {
+    FILE *stream;
+    struct SaveSnapshot *snap;
+};
+
+static struct SaveCacheEntry cache[SAVE_CACHE_SLOTS];
+static uint32_t cache_clock = 0;
+
+// Salvataggio in corso: da fopen a fclose nello stream in memoria, poi la
+// copia aspetta il rename che le da' il nome definitivo
+static FILE *write_stream = NULL;
+static char *write_buf = NULL;
+static size_t write_size = 0;
+static char write_tmp_path[SAVE_PATH_MAX];
+static struct SaveSnapshot *write_snap = NULL;
+
+// Letture dalle copie in RAM (G_DoLoadGame ne apre una alla volta)
+static struct SaveReader readers[2];
+
+// Dal gioco al thread di scrittura
+static struct SaveJob queue[SAVE_QUEUE_SIZE];
+static uint32_t queue_head = 0;
+static uint32_t queue_tail = 0;
+
+static SceUID save_thread = -1;
+static SceUID save_sema = -1;
+
+static int request = SAVE_REQUEST_NONE;
+
+static void snapshot_unref(struct SaveSnapshot *snap) {
+    if (snap && __atomic_sub_fetch(&snap->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        free(snap->data);
+        free(snap);
+    }
+}
+
+static struct SaveSnapshot *snapshot_ref(struct SaveSnapshot *snap) {
+    __atomic_add_fetch(&snap->refs, 1, __ATOMIC_RELAXED);
+    return snap;
+}
+
+// --- Thread di scrittura ---
+
+// Un solo sceIoWrite per salvataggio, passando da un file temporaneo: un
+// salvataggio a meta' non deve mai sostituire quello buono
+static void write_save(const struct SaveJob *job) {
+    char tmp_path[SAVE_PATH_MAX + 4];
+    SceUID fd;
+    int ok;
+
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", job->path);
+    sceIoMkdir(VITA_SAVE_DIR, 0777);
+
+    fd = sceIoOpen(tmp_path, SCE_O_WRONLY | SCE_O_CREAT | SCE_O_TRUNC, 0777);
+    if (fd < 0) {
+        printf("vita_save: cannot create %s (0x%08x)\n", tmp_path, fd);
+        return;
+    }
+
+    ok = sceIoWrite(fd, job->snap->data, job->snap->size) == (int)job->snap->size;
+    sceIoClose(fd);
+
+    if (!ok) {
+        printf("vita_save: write of %s failed\n", tmp_path);
+        sceIoRemove(tmp_path);
+        return;
+    }
+
+    sceIoRemove(job->path);
+    sceIoRename(tmp_path, job->path);
+}
+
+static int save_thread_main(SceSize args, void *argp) {
+    for (;;) {
+        uint32_t head;
+
+        sceKernelWaitSema(save_sema, 1, NULL);
+
+        head = __atomic_load_n(&queue_head, __ATOMIC_ACQUIRE);
+        while (queue_tail != head) {
+            struct SaveJob *job = &queue[queue_tail & SAVE_QUEUE_MASK];
+
+            write_save(job);
+            snapshot_unref(job->snap);
+            __atomic_store_n(&queue_tail, queue_tail + 1, __ATOMIC_RELEASE);
+        }
+    }
+
+    return 0;
+}
+
+static void queue_write(const char *path, struct SaveSnapshot *snap) {
+    uint32_t head = queue_head;
+    struct SaveJob *job;
+
+    // Senza thread la scrittura si fa qui, come in upstream
+    if (save_thread < 0) {
+        struct SaveJob direct;
+
+        snprintf(direct.path, sizeof(direct.path), "%s", path);
+        direct.snap = snap;
+        write_save(&direct);
+        return;
+    }
+
+    while (head - __atomic_load_n(&queue_tail, __ATOMIC_ACQUIRE) >= SAVE_QUEUE_SIZE)
+        sceKernelDelayThread(1000);
+
+    job = &queue[head & SAVE_QUEUE_MASK];
+    snprintf(job->path, sizeof(job->path), "%s", path);
+    job->snap = snapshot_ref(snap);
+    __atomic_store_n(&queue_head, head + 1, __ATOMIC_RELEASE);
+    sceKernelSignalSema(save_sema, 1);
+}
+
+void vita_save_flush(void) {
+    for (int waited = 0; waited < SAVE_FLUSH_TIMEOUT_MS; waited += 10) {
+        if (__atomic_load_n(&queue_tail, __ATOMIC_ACQUIRE) == queue_head)
+            return;
+        sceKernelDelayThread(10 * 1000);
+    }
+}
+
+void vita_save_init(void) {
+    save_sema = sceKernelCreateSema("cq_save", 0, 0, SAVE_QUEUE_SIZE, NULL);
+    if (save_sema < 0)
+        return;
+
+    // Sul core 1 sotto la priorita' del gioco: conta solo che arrivi
+    save_thread = sceKernelCreateThread("cq_save", save_thread_main, 0x10000100 + 24,
+                                        0x4000, 0, SCE_KERNEL_CPU_MASK_USER_1, NULL);
+    if (save_thread >= 0 && sceKernelStartThread(save_thread, 0, NULL) < 0)
+        save_thread = -1;
+
+    // Un salvataggio appena fatto non deve perdersi uscendo dal menu
+    if (save_thread >= 0)
+        I_AtExit(vita_save_flush, true);
+}
+
+char *vita_save_dir(char *iwadname) {
+    static char dir[] = VITA_SAVE_DIR "/";
+
+    sceIoMkdir(VITA_SAVE_DIR, 0777);
+    return dir;
+}
+
+// --- Copie in RAM ---
+
+static struct SaveCacheEntry *cache_find(const char *path) {
+    for (int i = 0; i < SAVE_CACHE_SLOTS; i++)
+        if (cache[i].snap && !strcmp(cache[i].path, path))
+            return &cache[i];
+
+    return NULL;
+}
+
+static void cache_put(const char *path, struct SaveSnapshot *snap) {
+    struct SaveCacheEntry *e = cache_find(path);
+
+    // Stesso slot, oppure quello usato meno di recente
+    if (!e) {
+        e = &cache[0];
+        for (int i = 1; i < SAVE_CACHE_SLOTS && e->snap; i++)
+            if (!cache[i].snap || cache[i].last_use < e->last_use)
+                e = &cache[i];
+    }
+
+    snapshot_unref(e->snap);
+    snprintf(e->path, sizeof(e->path), "%s", path);
+    e->snap = snapshot_ref(snap);
+    e->last_use = ++cache_clock;
+}
+
+// --- stdio di g_game.c ---
+
+FILE *vita_save_fopen(const char *path, const char *mode) {
+    if (mode[0] == 'w' && !write_stream) {
+        snapshot_unref(write_snap);
+        write_snap = NULL;
+
+        write_stream = open_memstream(&write_buf, &write_size);
+        if (write_stream) {
+            snprintf(write_tmp_path, sizeof(write_tmp_path), "%s", path);
+            return write_stream;
+        }
+    }
+
+    if (mode[0] == 'r') {
+        struct SaveCacheEntry *e = cache_find(path);
+
+        for (int i = 0; e && i < 2; i++) {
+            if (readers[i].stream)
+                continue;
+
+            readers[i].stream = fmemopen(e->snap->data, e->snap->size, "rb");
+            if (!readers[i].stream)
+                break;
+
+            readers[i].snap = snapshot_ref(e->snap);
+            e->last_use = ++cache_clock;
+            return readers[i].stream;
+        }
+    }
+
+    return fopen(path, mode);
+}
+
+int vita_save_fclose(FILE *stream) {
+    if (stream && stream == write_stream) {
+        int result = fclose(stream);
+
+        write_stream = NULL;
+        if (result != 0 || !write_buf) {
+            free(write_buf);
+            write_buf = NULL;
+            return EOF;
+        }
+
+        write_snap = malloc(sizeof(*write_snap));
+        if (!write_snap) {
+            free(write_buf);
+            write_buf = NULL;
+            return EOF;
+        }
+
+        write_snap->refs = 1;
+        write_snap->size = write_size;
+        write_snap->data = write_buf;
+        write_buf = NULL;
+        return 0;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        if (stream && readers[i].stream == stream) {
+            int result = fclose(stream);
+
+            readers[i].stream = NULL;
+            snapshot_unref(readers[i].snap);
+            readers[i].snap = NULL;
+            return result;
+        }
+    }
+
+    return fclose(stream);
+}
+
+// G_DoSaveGame cancella il vecchio salvataggio prima del rename: il file
+// e' ancora quello buono finche' il thread non ha scritto il nuovo
+int vita_save_remove(const char *path) {
+    if (write_snap)
+        return 0;
+
+    return remove(path);
+}
+
+int vita_save_rename(const char *oldpath, const char *newpath) {
+    if (write_snap && !strcmp(oldpath, write_tmp_path)) {
+        cache_put(newpath, write_snap);
+        queue_write(newpath, write_snap);
+        snapshot_unref(write_snap);
+        write_snap = NULL;
+        return 0;
+    }
+
+    return rename(oldpath, newpath);
+}
+
+// --- Salvataggio rapido ---
+
+void vita_save_request_quicksave(void) {
+    __atomic_store_n(&request, SAVE_REQUEST_QUICKSAVE, __ATOMIC_RELAXED);
+}
+
+void vita_save_request_quickload(void) {
+    __atomic_store_n(&request, SAVE_REQUEST_QUICKLOAD, __ATOMIC_RELAXED);
+}
+
+enum SaveRequest vita_save_take_request(void) {
+    return __atomic_exchange_n(&request, SAVE_REQUEST_NONE, __ATOMIC_RELAXED);
+}
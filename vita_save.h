@@ -0,0 +1,46 @@
+#ifndef VITA_SAVE_H
+#define VITA_SAVE_H
+
+#include <stdio.h>
+
+// Salvataggi in RAM: G_DoSaveGame scrive in una copia in memoria invece che
+// sulla memory card, e un thread la scrive poi con un solo sceIoWrite in
+// ux0:data/ChexQuest/saves. Le ultime copie restano in memoria, cosi' anche
+// il caricamento non legge dalla scheda. SELECT+QUADRATO e SELECT+TRIANGOLO
+// sono salvataggio e caricamento rapido.
+
+#define VITA_SAVE_DIR "ux0:data/ChexQuest/saves"
+
+// Slot del salvataggio rapido: fuori dai 6 del menu
+#define VITA_QUICKSAVE_SLOT 6
+
+enum SaveRequest {
+    SAVE_REQUEST_NONE,
+    SAVE_REQUEST_QUICKSAVE,
+    SAVE_REQUEST_QUICKLOAD,
+};
+
+// Da DG_Init: avvia il thread di scrittura
+void vita_save_init(void);
+
+// Al posto di M_GetSaveGameDir in D_DoomMain (engine/d_main_vita.c)
+char *vita_save_dir(char *iwadname);
+
+// Al posto delle funzioni di stdio nei salvataggi di g_game.c
+// (engine/g_game_vita.c): scrittura e lettura passano dalle copie in RAM
+FILE *vita_save_fopen(const char *path, const char *mode);
+int vita_save_fclose(FILE *stream);
+int vita_save_remove(const char *path);
+int vita_save_rename(const char *oldpath, const char *newpath);
+
+// Azioni delle combinazioni (thread dell'ingresso): alzano solo una richiesta
+void vita_save_request_quicksave(void);
+void vita_save_request_quickload(void);
+
+// Dal thread del gioco: la richiesta in sospeso, azzerandola
+enum SaveRequest vita_save_take_request(void);
+
+// Aspetta che le scritture in coda siano sulla scheda (all'uscita)
+void vita_save_flush(void);
+
+#endif
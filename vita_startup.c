@@ -0,0 +1,97 @@
+#include "doomgeneric.h"
+#include "doomstat.h"
+#include "m_argv.h"
+#include "r_data.h"
+#include <stdio.h>
+#include <string.h>
+
+#include "vita_startup.h"
+
+#define STARTUP_LOG_PATH "ux0:data/ChexQuest/startup.log"
+
+#define STARTUP_MAX_PHASES 32
+#define STARTUP_NAME_LEN 24
+
+struct StartupPhase {
+    char name[STARTUP_NAME_LEN];
+    uint32_t start_ms;              // da DG_GetTicksMs, cioe' dall'avvio
+};
+
+int vita_fastboot = 0;
+
+static struct StartupPhase phases[STARTUP_MAX_PHASES];
+static int num_phases = 0;
+static int startup_done = 0;
+
+// precache spento da -fastboot, da rimettere a fine attesa del titolo
+static int precache_pending = 0;
+static boolean saved_precache;
+
+void vita_startup_init(void) {
+    vita_fastboot = M_CheckParm("-fastboot") > 0;
+
+    // Solo durante l'attesa del titolo: i livelli caricati dopo tornano a
+    // leggere tutte le texture e gli sprite prima di partire
+    if (vita_fastboot) {
+        saved_precache = precache;
+        precache = false;
+        precache_pending = 1;
+    }
+}
+
+void vita_startup_hold_done(void) {
+    if (!precache_pending)
+        return;
+
+    precache = saved_precache;
+    precache_pending = 0;
+}
+
+void vita_startup_mark(const char *phase) {
+    if (startup_done || num_phases >= STARTUP_MAX_PHASES)
+        return;
+
+    snprintf(phases[num_phases].name, STARTUP_NAME_LEN, "%s", phase);
+    phases[num_phases].start_ms = DG_GetTicksMs();
+    num_phases++;
+}
+
+static void write_startup_log(uint32_t end_ms) {
+    FILE *f = fopen(STARTUP_LOG_PATH, "w");
+    if (!f)
+        return;
+
+    fprintf(f, "startup: %u ms to first frame%s\n", (unsigned)end_ms,
+            vita_fastboot ? " (fastboot)" : "");
+
+    for (int i = 0; i < num_phases; i++) {
+        uint32_t next = i + 1 < num_phases ? phases[i + 1].start_ms : end_ms;
+
+        fprintf(f, "%-*s %6u ms  (+%u)\n", STARTUP_NAME_LEN, phases[i].name,
+                (unsigned)(next - phases[i].start_ms), (unsigned)phases[i].start_ms);
+    }
+
+    fclose(f);
+}
+
+void vita_startup_frame(void) {
+    if (startup_done)
+        return;
+
+    write_startup_log(DG_GetTicksMs());
+    startup_done = 1;
+}
+
+void vita_startup_tick(void) {
+    // Partita iniziata dal menu prima della fine dell'attesa: il livello e'
+    // stato caricato senza precache, lo si completa adesso
+    if (precache_pending && gamestate == GS_LEVEL) {
+        vita_startup_hold_done();
+        if (precache)
+            R_PrecacheLevel();
+    }
+
+#ifdef VITA_TEXTURE_CACHE
+    R_TextureCacheTick();
+#endif
+}
@@ -0,0 +1,30 @@
+#ifndef VITA_STARTUP_H
+#define VITA_STARTUP_H
+
+// Profilo dell'avvio: ogni fase di D_DoomMain viene marcata con il tempo
+// del suo inizio, e al primo frame il riepilogo va in startup.log.
+// -fastboot rimanda quello che non serve a mostrare il titolo.
+
+extern int vita_fastboot;
+
+// Da D_DoomMain (engine/d_main_vita.c), prima di tutto il resto
+void vita_startup_init(void);
+
+// Inizio di una fase; il nome viene copiato
+void vita_startup_mark(const char *phase);
+
+// Da DG_DrawFrame: al primo frame chiude il profilo e scrive il log
+void vita_startup_frame(void);
+
+// Da vita_DeferedPlayDemo (engine/d_main_vita.c) quando finisce l'attesa
+// delle demo del titolo: rimette precache come prima di -fastboot
+void vita_startup_hold_done(void);
+
+// Una volta per giro del loop principale: lavoro rimandato da -fastboot e
+// la scrittura della cache delle texture
+void vita_startup_tick(void);
+
+// Scrittura rimandata della cache delle texture (engine/r_data_vita.c)
+void R_TextureCacheTick(void);
+
+#endif